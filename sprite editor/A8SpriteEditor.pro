@@ -9,19 +9,49 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    blend.cpp \
+    brush.cpp \
     canvaslabel.cpp \
+    floodfill.cpp \
+    framelistmodel.cpp \
+    frame.cpp \
+    history.cpp \
+    journal.cpp \
+    latencymonitor.cpp \
+    layerstack.cpp \
+    legacyprojectreader.cpp \
     main.cpp \
     mainwindow.cpp \
     model.cpp \
     newfile.cpp \
-    sprite.cpp
+    onionskin.cpp \
+    palette.cpp \
+    previewcache.cpp \
+    recolor.cpp \
+    sprite.cpp \
+    transform.cpp
 
 HEADERS += \
+    blend.h \
+    brush.h \
     canvaslabel.h \
+    floodfill.h \
+    framelistmodel.h \
+    frame.h \
+    history.h \
+    journal.h \
+    latencymonitor.h \
+    layerstack.h \
+    legacyprojectreader.h \
     mainwindow.h \
     model.h \
     newfile.h \
-    sprite.h
+    onionskin.h \
+    palette.h \
+    previewcache.h \
+    recolor.h \
+    sprite.h \
+    transform.h
 
 FORMS += \
     mainwindow.ui \
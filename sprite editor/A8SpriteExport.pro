@@ -0,0 +1,46 @@
+# Headless batch exporter: converts .ssp projects to PNGs without needing a display.
+# Run with --bench to time the core sprite operations instead.
+# QImage only needs the gui module's image code, not a QGuiApplication, so no widgets are linked.
+QT       += core gui
+QT       -= widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = a8spriteexport
+
+SOURCES += \
+    batchexporter.cpp \
+    benchmark.cpp \
+    blend.cpp \
+    brush.cpp \
+    exportmain.cpp \
+    floodfill.cpp \
+    frame.cpp \
+    history.cpp \
+    layerstack.cpp \
+    legacyprojectreader.cpp \
+    palette.cpp \
+    recolor.cpp \
+    sprite.cpp \
+    transform.cpp
+
+HEADERS += \
+    batchexporter.h \
+    benchmark.h \
+    blend.h \
+    brush.h \
+    floodfill.h \
+    frame.h \
+    history.h \
+    layerstack.h \
+    legacyprojectreader.h \
+    palette.h \
+    recolor.h \
+    sprite.h \
+    transform.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
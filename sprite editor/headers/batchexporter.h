@@ -0,0 +1,89 @@
+/**
+ * Converts .ssp projects to PNG files without a GUI, for use from the command line. Each project becomes
+ * a numbered PNG per frame, a single sprite sheet, or both, and projects are converted in parallel.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef BATCHEXPORTER_H
+#define BATCHEXPORTER_H
+
+#include <functional>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "sprite.h"
+
+class BatchExporter
+{
+public:
+    struct Options {
+        QString outputDir;      // Where to write the PNGs, empty to write them next to each project
+        bool sequence = true;   // Write one PNG per frame
+        bool sheet = false;     // Write every frame into one PNG
+        int sheetColumns = 0;   // Frames per sheet row, 0 to make the sheet roughly square
+        bool recursive = false; // Look for projects in subdirectories too
+        int jobs = 0;           // Projects converted at once, 0 for one per core
+    };
+
+    /**
+     * A project to convert and the directory its PNGs go in.
+     */
+    struct Project {
+        QString path;
+        QString outputDir;
+    };
+
+    /**
+     * Called as each project finishes, from whichever thread converted it.
+     * @param project - the project
+     * @param frames - the number of frames exported
+     * @param error - why the project failed, empty if it succeeded
+     */
+    using ResultCallback = std::function<void(const Project& project, int frames, const QString& error)>;
+
+    BatchExporter(const Options& options);
+
+    /**
+     * Expands files and directories given on the command line into the projects to convert. A directory
+     * contributes every .ssp file in it, and when an output directory is set its PNGs go into a subdirectory
+     * of the same name, with projects found in subdirectories going into matching subdirectories of that.
+     * A project given more than once is converted once.
+     * @param paths - .ssp files and directories
+     * @param errors - receives a message for each path which does not exist, and for each project which
+     *                 would write the same PNGs as one before it and so is skipped
+     * @return QVector<Project> the projects, in a stable order
+     */
+    QVector<Project> findProjects(const QStringList& paths, QStringList& errors) const;
+
+    /**
+     * Converts every project, several at once, and returns once all are done.
+     * @param projects - the projects to convert
+     * @param onResult - called as each project finishes
+     * @return int the number of projects which failed
+     */
+    int run(const QVector<Project>& projects, const ResultCallback& onResult) const;
+
+    /**
+     * Converts one project on the calling thread.
+     * @param project - the project to convert
+     * @param error - receives why the conversion failed
+     * @return int the number of frames exported, or -1 if the conversion failed
+     */
+    int exportProject(const Project& project, QString& error) const;
+
+    /**
+     * Lays every frame of a sprite out left to right, top to bottom, in one image.
+     * @param sprite - the sprite
+     * @param columns - frames per row, 0 to make the sheet roughly square
+     * @return QImage the sheet, or a null image if it would be too large
+     */
+    static QImage buildSheet(Sprite& sprite, int columns);
+
+private:
+    Options options;
+};
+
+#endif // BATCHEXPORTER_H
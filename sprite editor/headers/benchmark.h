@@ -0,0 +1,87 @@
+/**
+ * Times the core sprite operations over a range of canvas sizes and frame counts, writing the results as
+ * JSON and comparing them against a stored baseline so performance regressions can be caught by a script.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <QJsonDocument>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class QTextStream;
+
+class Benchmark
+{
+public:
+    static const qint64 DEFAULT_MIN_TIME_MS = 200;
+
+    struct Result {
+        QString name;
+        QSize size;
+        int frames;
+        qint64 iterations;
+        double nsPerIteration;
+
+        /**
+         * Returns the name, size and frame count, which identify the result across runs.
+         */
+        QString key() const;
+    };
+
+    /**
+     * Constructs a benchmark over every combination of the given sizes and frame counts. Operations on a
+     * single frame are only timed once per size.
+     * @param sizes - the canvas sizes
+     * @param frameCounts - the frame counts for operations on whole sprites
+     * @param minTimeMs - how long each operation is repeated for at least
+     */
+    Benchmark(const QVector<QSize>& sizes, const QVector<int>& frameCounts, qint64 minTimeMs = DEFAULT_MIN_TIME_MS);
+
+    /**
+     * Times every operation, printing each result as it finishes.
+     * @param log - receives a line per result
+     * @return QVector<Result> the results
+     */
+    QVector<Result> run(QTextStream& log) const;
+
+    /**
+     * Converts results to a JSON document.
+     */
+    static QJsonDocument toJson(const QVector<Result>& results);
+
+    /**
+     * Reads results from a JSON document written by toJson.
+     */
+    static QVector<Result> fromJson(const QJsonDocument& document);
+
+    /**
+     * Compares results against a baseline of the same operations, printing the change of each.
+     * @param results - the new results
+     * @param baseline - the stored results
+     * @param threshold - how many percent slower a result may be before it counts as a regression
+     * @param log - receives a line per compared result
+     * @return int the number of regressions
+     */
+    static int compare(const QVector<Result>& results, const QVector<Result>& baseline, double threshold, QTextStream& log);
+
+private:
+    QVector<QSize> sizes;
+    QVector<int> frameCounts;
+    qint64 minTimeMs;
+
+    /**
+     * Repeats an operation, doubling the repetitions until they take at least minTimeMs.
+     * @param operation - the operation, which is given the iteration number
+     * @return Result the result, without its name, size or frame count
+     */
+    Result measure(const std::function<void(qint64 iteration)>& operation) const;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,71 @@
+/**
+ * The footprint of the pen and eraser. A brush's mask is stored as one span per row and cached for each
+ * shape and size, and a stroke is drawn a straight segment at a time: the stamps along a segment cover one
+ * span per row between them, so each pixel of the segment is written once however large the brush is.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef BRUSH_H
+#define BRUSH_H
+
+#include "blend.h"
+#include "frame.h"
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+
+/**
+ * The shape of a brush. The order matches the brush shape box in the view.
+ */
+enum class BrushShape {ROUND, SQUARE};
+
+class Brush
+{
+public:
+    static const int MAX_SIZE = 256; // The largest width and height of a brush in pixels
+
+    /**
+     * Constructs a brush, computing its mask only if no brush of the same shape and size was made before.
+     * Brushes are made on the UI thread, which the mask cache relies on.
+     * @param shape - the brush's shape
+     * @param size - the brush's width and height in pixels, clamped to 1 to MAX_SIZE
+     */
+    Brush(BrushShape shape = BrushShape::ROUND, int size = 1);
+
+    BrushShape getShape() const;
+    int getSize() const;
+
+    /**
+     * Draws the brush at every center, which must lie along one straight line as made by Bresenham's
+     * algorithm, and clips it to the frame.
+     * @param frame - the frame to draw on
+     * @param under - the frame to read the pixels under the brush from, which may be the frame itself
+     * @param centers - the centers of the stamps
+     * @param color - the ARGB32 color to draw with
+     * @param mode - how to composite the color
+     * @return QRect the bounding rectangle of the pixels drawn on
+     */
+    QRect stroke(Frame& frame, const Frame& under, const QVector<QPoint>& centers, QRgb color, BlendMode mode) const;
+
+private:
+    /**
+     * The part of one row of the mask which the brush covers.
+     */
+    struct Span {
+        int left;
+        int length;
+    };
+
+    BrushShape shape;
+    int size;
+    QVector<Span> spans; // One per row, shared with the cached mask
+
+    /**
+     * Returns the mask of a shape and size, one span per row from the top.
+     */
+    static QVector<Span> makeMask(BrushShape shape, int size);
+};
+
+#endif // BRUSH_H
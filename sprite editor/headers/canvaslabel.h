@@ -1,6 +1,7 @@
 /**
  * Represent the Canvas area of sprite editor. It is an interactive drawing surface where mouse movements can
- * be recorded to trigger drawing actions.
+ * be recorded to trigger drawing actions. Large sprites can be zoomed with the mouse wheel and panned by
+ * dragging with the middle mouse button, and only the part of the sprite in view is ever drawn.
  *
  * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
  * March 31, 2025
@@ -11,22 +12,184 @@
 #ifndef CANVASLABEL_H
 #define CANVASLABEL_H
 
+#include <QFont>
 #include <QLabel>
 #include <QPoint>
+#include <QRect>
+#include <QImage>
 #include <QMouseEvent>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QTimer>
+#include <QWheelEvent>
+#include <QVector>
+#include "frame.h"
+#include "latencymonitor.h"
 
 class CanvasLabel : public QLabel
 {
     Q_OBJECT
 
 signals:
-    void draw(QPoint pos);
+    /**
+     * Emitted with the mouse positions of a stroke, batched to at most once per display frame.
+     * @param positions - the positions, relative to this CanvasLabel, in the order they were received
+     * @param newStroke - if the first position is where the mouse was pressed
+     */
+    void draw(const QVector<QPoint>& positions, bool newStroke);
+
+    /**
+     * Emitted when the mouse is released, after the last positions of the stroke have been drawn.
+     */
+    void strokeFinished();
+
+    /**
+     * Emitted when the canvas zooms or scrolls, after which the whole frame should be drawn again.
+     */
+    void viewportChanged();
 
 public:
     CanvasLabel(QWidget *parent = nullptr);
 
+    /**
+     * Redraws the cells of the canvas covered by the dirty rectangle from the given frame, over a checkerboard.
+     * Only the pixels inside the viewport are read. The canvas is zoomed to fit if the frame's size has
+     * changed since the last draw.
+     * @param frame - the sprite's frame
+     * @param dirtyRect - the pixels of the frame which changed
+     */
+    void drawFrame(const Frame& frame, QRect dirtyRect);
+
+    /**
+     * Sets the onion skin shown beneath the frame, which takes effect as the frame is next drawn.
+     * @param composite - the faded neighboring frames in premultiplied ARGB32, or a null frame for none
+     */
+    void setOnionSkin(const Frame& composite);
+
+    /**
+     * Prepares the canvas for a sprite of the given size, zoomed to fit the canvas.
+     * @param spriteSize - the sprite's width and height
+     */
+    void setSpriteSize(QSize spriteSize);
+
+    /**
+     * Returns the sprite pixel shown at a position on the canvas.
+     * @param pos - the position, relative to this CanvasLabel
+     * @return QPoint the pixel, which may lie outside the sprite
+     */
+    QPoint pixelAt(QPoint pos) const;
+
+    /**
+     * Sets where the canvas records how long input takes to be batched, and how long repaints take to be
+     * presented. Nothing is recorded until this is set.
+     * @param monitor - the monitor, which must outlive the canvas
+     */
+    void setLatencyMonitor(LatencyMonitor *monitor);
+
+    /**
+     * Shows or hides the latency percentiles in the top left corner of the canvas.
+     * @param visible - if the overlay should be shown
+     */
+    void setLatencyOverlayVisible(bool visible);
+
+private slots:
+    /**
+     * Emits every pending mouse position in a single draw signal.
+     */
+    void flushPositions();
+
 private:
+    static const int FLUSH_INTERVAL = 16; // About one frame at 60Hz
+    static const int MAX_ZOOM = 64;       // Canvas pixels per sprite pixel
+    static const int CHECKER_SIZE = 8;    // Size of the checkerboard squares when zoomed out
+    static constexpr QRgb CHECKER_LIGHT = 0xffc8c8c8;
+    static constexpr QRgb CHECKER_DARK = 0xff969696;
+    static const int OVERLAY_INTERVAL = 250; // How often the latency overlay refreshes, in milliseconds
+
     bool isDrawing = false;
+    QVector<QPoint> pendingPositions; // Mouse positions received since the last draw signal
+    QTimer flushTimer;
+    QImage backing; // The frame scaled to the size of the canvas, premultiplied for fast painting
+    QSize imageSize;
+    QVector<QRgb> rowBuffer;   // One dirty row of the frame, read out of its tiles
+    QVector<QRgb> onionBuffer; // The same row of the onion skin
+    Frame onionSkin;           // Shares its tiles with the model's composite
+    QVector<int> columnSource; // The sprite column shown in each canvas column being drawn
+
+    // Viewport
+    double zoom = 1;     // Canvas pixels per sprite pixel
+    QPoint offset;       // Where the sprite's top left corner is on the canvas
+    bool isPanning = false;
+    QPoint lastPanPos;
+
+    // Latency instrumentation, all times from the monitor's clock
+    LatencyMonitor *latency = nullptr;
+    qint64 batchStart = -1;    // When the first pending position was received
+    qint64 drawingInput = -1;  // When the input of the batch being drawn was received
+    qint64 presentStart = -1;  // When the canvas first asked to be repainted since it last painted
+    qint64 presentInput = -1;  // When the oldest input waiting to be painted was received
+    bool showLatency = false;
+    QTimer overlayTimer;
+    QRect overlayRect;
+    QFont overlayFont;
+
+    /**
+     * Returns the canvas column where the given sprite column starts.
+     * @param x - the sprite column, may be one past the last column
+     */
+    int cellLeft(int x) const;
+
+    /**
+     * Returns the canvas row where the given sprite row starts.
+     * @param y - the sprite row, may be one past the last row
+     */
+    int cellTop(int y) const;
+
+    /**
+     * Returns the sprite column shown in the given canvas column.
+     */
+    int pixelColumn(int x) const;
+
+    /**
+     * Returns the sprite row shown in the given canvas row.
+     */
+    int pixelRow(int y) const;
+
+    /**
+     * Returns the pixels of the sprite which are at least partly in view.
+     */
+    QRect visibleRect() const;
+
+    /**
+     * Returns the zoom at which the whole sprite fits the canvas.
+     */
+    double fitZoom() const;
+
+    /**
+     * Moves the viewport, keeping the sprite centered along any axis where it fits and otherwise keeping the
+     * canvas covered, then clears the canvas until the frame is drawn again.
+     * @param newZoom - canvas pixels per sprite pixel
+     * @param newOffset - where the sprite's top left corner should be on the canvas
+     */
+    void setViewport(double newZoom, QPoint newOffset);
+
+    /**
+     * Paints the canvas through the persistent backing image, only within the region being repainted.
+     * @param event - the paint event
+     */
+    void paintEvent(QPaintEvent *event) override;
+
+    /**
+     * Refits the sprite to the new canvas size.
+     * @param event - the resize event
+     */
+    void resizeEvent(QResizeEvent *event) override;
+
+    /**
+     * Zooms in or out by a factor of two per wheel step, keeping the pixel under the mouse in place.
+     * @param event - the wheel event
+     */
+    void wheelEvent(QWheelEvent *event) override;
     /**
      * Handle mouse move event, mousePos contains the coordinates relative to this CanvasLabel.
      * @param event - the mouse event
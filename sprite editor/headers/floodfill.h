@@ -0,0 +1,45 @@
+/**
+ * Scanline flood fill used by the fill tool. Works directly on the pixels of a tiled frame, filling whole
+ * horizontal spans at a time and tracking visited pixels in a bitmap.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include "frame.h"
+#include <QPoint>
+#include <QRect>
+
+/**
+ * Which neighbors of a pixel a fill can spread to.
+ */
+enum class Connectivity {FOUR, EIGHT};
+
+class FloodFill
+{
+public:
+    /**
+     * Replaces the color of every pixel connected to the seed whose color is within the tolerance of the
+     * seed's original color.
+     * @param frame - the frame to fill
+     * @param seed - the pixel the fill starts from
+     * @param color - the color to fill with
+     * @param tolerance - the largest difference allowed in any one channel, from 0 (exact) to 255
+     * @param connectivity - if the fill can also spread diagonally
+     * @param mode - how the color is composited onto each filled pixel, each pixel being drawn on once
+     * @return QRect the bounding rectangle of the filled pixels, empty if nothing changed
+     */
+    static QRect fill(Frame& frame, QPoint seed, QRgb color, int tolerance = 0, Connectivity connectivity = Connectivity::FOUR,
+                      BlendMode mode = BlendMode::REPLACE);
+
+private:
+    /**
+     * Returns if every channel of the pixel is within the tolerance of the target's.
+     */
+    static bool matches(QRgb pixel, QRgb target, int tolerance);
+};
+
+#endif // FLOODFILL_H
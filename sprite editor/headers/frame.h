@@ -1,25 +1,302 @@
+/**
+ * Represents one frame of a sprite, stored as a grid of reference counted 16x16 tiles. Copying a frame only
+ * copies the tile pointers, and a tile is cloned the first time it is written to while shared, so frames
+ * which are nearly identical (the common case in animation) share most of their memory.
+ *
+ * A frame holds either ARGB32 tiles or 8-bit indexed tiles read through a palette. Indexed frames still read
+ * and write ARGB32 colors, converting through the palette, so the rest of the editor does not need to know
+ * which a frame is. Colors written to an indexed frame which are not in its palette become the closest one.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
 #ifndef FRAME_H
 #define FRAME_H
 
-#include <vector>
-#include <QColor>
-using std::vector;
+#include <QImage>
+#include <QRect>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QVector>
+#include "blend.h"
+#include "palette.h"
 
 class Frame{
-private:
-    int width, height;
-    vector<vector<QColor>> imageData;
 public:
-    Frame(int width, int height);
-    Frame(vector<vector<QColor>>& imageData);
-    ~Frame();
+    static const int TILE_SHIFT = 4;
+    static const int TILE_SIZE = 1 << TILE_SHIFT;
+    static const int TILE_MASK = TILE_SIZE - 1;
+
+    /**
+     * Constructs a null frame with no pixels.
+     */
+    Frame();
+
+    /**
+     * Constructs a frame filled with one color. Every tile starts out shared, so a blank frame costs almost
+     * no memory until it is drawn on.
+     * @param width - the width of the frame in pixels
+     * @param height - the height of the frame in pixels
+     * @param color - the ARGB32 color to fill the frame with (default = transparent)
+     */
+    Frame(int width, int height, QRgb color = 0);
+
+    /**
+     * Constructs an indexed frame filled with one palette index.
+     * @param width - the width of the frame in pixels
+     * @param height - the height of the frame in pixels
+     * @param palette - the palette the frame's indices refer to
+     * @param index - the index to fill the frame with
+     */
+    Frame(int width, int height, const Palette& palette, quint8 index);
+
+    /**
+     * Constructs a frame holding a copy of an image's pixels.
+     * @param image - the image to copy, which must be ARGB32
+     */
+    explicit Frame(const QImage& image);
+
+    int getWidth() const;
+    int getHeight() const;
+
+    /**
+     * Returns the rectangle covering every pixel of the frame.
+     */
+    QRect getRect() const;
+
+    /**
+     * Returns if the frame has no pixels.
+     */
+    bool isNull() const;
+
+    /**
+     * Returns if the frame stores palette indices rather than colors.
+     */
+    bool isIndexed() const;
+
+    /**
+     * Returns the palette of an indexed frame.
+     */
+    const Palette& getPalette() const;
+
     /**
-     * Sets the color of a pixel at the given x y position in the frame.
+     * Replaces the palette of an indexed frame, which recolors every pixel without touching the tiles.
+     * @param palette - the new palette
+     */
+    void setPalette(const Palette& palette);
+
+    /**
+     * Returns a copy of the frame with its pixels indexed into the given palette, each pixel becoming the
+     * closest color in the palette.
+     * @param palette - the palette
+     */
+    Frame toIndexed(const Palette& palette) const;
+
+    /**
+     * Returns a copy of the frame storing ARGB32 colors.
+     */
+    Frame toArgb() const;
+
+    /**
+     * Gets the color of a pixel, which must be inside the frame.
+     * @param x - the x position of the pixel
+     * @param y - the y position of the pixel
+     * @return QRgb ARGB32 pixel color
+     */
+    QRgb getPixel(int x, int y) const;
+
+    /**
+     * Sets the color of a pixel, which must be inside the frame.
      * @param x - the x position of the pixel
      * @param y - the y position of the pixel
-     * @param color - the color to set the pixel to
+     * @param color - the ARGB32 color to set the pixel to
+     */
+    void setPixel(int x, int y, QRgb color);
+
+    /**
+     * Fills a rectangle with one color, clipped to the frame.
+     * @param rect - the rectangle to fill
+     * @param color - the ARGB32 color to fill with
+     * @return QRect the part of the rectangle which was filled
+     */
+    QRect fillRect(QRect rect, QRgb color);
+
+    /**
+     * Blends one color onto a rectangle, clipped to the frame, working directly on the tiles' rows.
+     * @param rect - the rectangle to draw on
+     * @param color - the ARGB32 color to blend
+     * @param mode - how to composite the color
+     * @return QRect the part of the rectangle which was drawn on
+     */
+    QRect blendRect(QRect rect, QRgb color, BlendMode mode);
+
+    /**
+     * Copies a run of pixels from one row of the frame. The run must be inside the frame.
+     * @param x - the first pixel of the run
+     * @param y - the row
+     * @param count - the number of pixels in the run
+     * @param out - receives count pixels
+     */
+    void readRow(int x, int y, int count, QRgb* out) const;
+
+    /**
+     * Overwrites a run of pixels in one row of the frame. The run must be inside the frame.
+     * @param x - the first pixel of the run
+     * @param y - the row
+     * @param count - the number of pixels in the run
+     * @param in - the count pixels to write
+     */
+    void writeRow(int x, int y, int count, const QRgb* in);
+
+    /**
+     * Copies the pixels of a rectangle, row by row, into a buffer of rect.width() * rect.height() pixels.
+     * The rectangle must be inside the frame.
+     */
+    void readRect(QRect rect, QRgb* out) const;
+
+    /**
+     * Overwrites the pixels of a rectangle, row by row, from a buffer of rect.width() * rect.height() pixels.
+     * The rectangle must be inside the frame.
+     */
+    void writeRect(QRect rect, const QRgb* in);
+
+    /**
+     * Copies the palette indices of a rectangle of an indexed frame, row by row, into a buffer of
+     * rect.width() * rect.height() bytes. The rectangle must be inside the frame.
+     */
+    void readIndices(QRect rect, quint8* out) const;
+
+    /**
+     * Overwrites the palette indices of a rectangle of an indexed frame, row by row, from a buffer of
+     * rect.width() * rect.height() bytes. The rectangle must be inside the frame.
+     */
+    void writeIndices(QRect rect, const quint8* in);
+
+    /**
+     * Returns the number of tile columns in the frame.
+     */
+    int getTileColumns() const;
+
+    /**
+     * Returns the number of tile rows in the frame.
+     */
+    int getTileRows() const;
+
+    /**
+     * Returns the rectangle of a tile, clipped to the frame.
+     * @param column - the tile's column
+     * @param row - the tile's row
+     */
+    QRect tileRect(int column, int row) const;
+
+    /**
+     * Returns if a tile of this frame is the very same tile as in the other frame, meaning neither frame has
+     * written to it since one was copied from the other. This is a pointer comparison, and indexed tiles
+     * must also have the same palette.
+     */
+    bool sharesTile(const Frame& other, int column, int row) const;
+
+    /**
+     * Returns if every tile of this frame is shared with the other frame, meaning neither has been drawn on
+     * since one was copied from the other.
+     */
+    bool sharesTiles(const Frame& other) const;
+
+    /**
+     * Returns if a tile of this frame holds the same pixels as in the other frame of the same size.
      */
-    void setPixel(int x, int y, QColor color);
+    bool tileEquals(const Frame& other, int column, int row) const;
+
+    /**
+     * Replaces every tile holding the same pixels as the reference frame's tile with a shared pointer to it,
+     * so frames decoded one after another share memory just like frames duplicated in the editor.
+     * @param reference - a frame of the same size, usually the previous frame of the sprite
+     */
+    void shareIdenticalTiles(const Frame& reference);
+
+    /**
+     * Copies the frame into a contiguous ARGB32 image, for display and export.
+     */
+    QImage toImage() const;
+
+    /**
+     * Copies part of the frame into a contiguous ARGB32 image.
+     * @param rect - the part to copy, which must be inside the frame
+     */
+    QImage toImage(QRect rect) const;
+
+    /**
+     * Shrinks or stretches the frame into an image of the given size by sampling the nearest pixel, reading
+     * only the pixels which end up in the image.
+     * @param size - the size of the image
+     */
+    QImage toImage(QSize size) const;
+
+private:
+    struct Tile : public QSharedData {
+        QRgb pixels[TILE_SIZE * TILE_SIZE];
+    };
+
+    struct IndexedTile : public QSharedData {
+        quint8 indices[TILE_SIZE * TILE_SIZE];
+    };
+
+    int width = 0;
+    int height = 0;
+    int columns = 0;
+    int rows = 0;
+    QVector<QSharedDataPointer<Tile>> tiles;               // Empty for indexed frames
+    QVector<QSharedDataPointer<IndexedTile>> indexedTiles; // Empty for ARGB32 frames
+    Palette palette;
+
+    const Tile& constTile(int x, int y) const;
+    Tile& tile(int x, int y);
+    const IndexedTile& constIndexedTile(int x, int y) const;
+    IndexedTile& indexedTile(int x, int y);
+
+    /**
+     * Returns the index of a pixel within its tile.
+     */
+    static int tileOffset(int x, int y);
 };
 
+inline const Frame::Tile& Frame::constTile(int x, int y) const{
+    return *tiles.at((y >> TILE_SHIFT) * columns + (x >> TILE_SHIFT)).constData();
+}
+
+inline Frame::Tile& Frame::tile(int x, int y){
+    // Non const access clones the tile if another frame still shares it
+    return *tiles[(y >> TILE_SHIFT) * columns + (x >> TILE_SHIFT)].data();
+}
+
+inline const Frame::IndexedTile& Frame::constIndexedTile(int x, int y) const{
+    return *indexedTiles.at((y >> TILE_SHIFT) * columns + (x >> TILE_SHIFT)).constData();
+}
+
+inline Frame::IndexedTile& Frame::indexedTile(int x, int y){
+    return *indexedTiles[(y >> TILE_SHIFT) * columns + (x >> TILE_SHIFT)].data();
+}
+
+inline int Frame::tileOffset(int x, int y){
+    return ((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK);
+}
+
+inline bool Frame::isIndexed() const{
+    return !indexedTiles.isEmpty();
+}
+
+inline QRgb Frame::getPixel(int x, int y) const{
+    if (isIndexed())
+        return palette.color(constIndexedTile(x, y).indices[tileOffset(x, y)]);
+    return constTile(x, y).pixels[tileOffset(x, y)];
+}
+
+inline void Frame::setPixel(int x, int y, QRgb color){
+    if (isIndexed())
+        indexedTile(x, y).indices[tileOffset(x, y)] = palette.indexOf(color);
+    else
+        tile(x, y).pixels[tileOffset(x, y)] = color;
+}
+
 #endif // FRAME_H
@@ -0,0 +1,88 @@
+/**
+ * The list of frames shown in the frame strip. Items are only data, so the strip's view only creates what is
+ * on screen no matter how many frames there are. Each frame has a revision which goes up whenever the frame
+ * changes; thumbnails are requested for the current revision and any finished for an older one are ignored.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef FRAMELISTMODEL_H
+#define FRAMELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QImage>
+#include <QPixmap>
+#include <QVariant>
+#include <QVector>
+
+class FrameListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    static const int THUMBNAIL_SIZE = 48;
+
+    explicit FrameListModel(QObject *parent = nullptr);
+
+    /**
+     * Returns the number of frames in the list.
+     */
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    /**
+     * Returns a frame's label, or its thumbnail as the decoration. A missing or outdated thumbnail is
+     * requested the first time the view asks for it, and the outdated one is shown until the new one is ready.
+     */
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * Returns the number of frames in the list.
+     */
+    int getFrameCount() const;
+
+    /**
+     * Adds or removes frames at the end of the list. Frames which move because one was removed or inserted
+     * in the middle are invalidated by the model.
+     * @param frameCount - the number of frames the sprite now has
+     */
+    void setFrameCount(int frameCount);
+
+signals:
+    /**
+     * Emitted when a thumbnail is needed for a frame.
+     * @param frameIndex - the frame
+     * @param revision - the frame's revision, to be passed back with the thumbnail
+     * @param size - the largest width and height of the thumbnail
+     */
+    void thumbnailRequested(int frameIndex, quint64 revision, int size);
+
+public slots:
+    /**
+     * Stores a finished thumbnail if it is still for the frame's current revision.
+     * @param frameIndex - the frame
+     * @param revision - the frame revision the thumbnail was made from
+     * @param thumbnail - the thumbnail
+     */
+    void setThumbnail(int frameIndex, quint64 revision, const QImage& thumbnail);
+
+    /**
+     * Moves a range of frames to a new revision, so their thumbnails are made again when next shown.
+     * @param firstFrame - the first changed frame
+     * @param lastFrame - the last changed frame, or -1 for every frame after firstFrame
+     */
+    void invalidate(int firstFrame, int lastFrame);
+
+private:
+    struct Item {
+        quint64 revision = 0;
+        quint64 thumbnailRevision = 0; // The revision the thumbnail was made from
+        bool requested = false;        // If a thumbnail of the current revision is being made
+        QPixmap thumbnail;
+    };
+
+    QVector<Item> items;
+    quint64 nextRevision = 1;
+};
+
+#endif // FRAMELISTMODEL_H
@@ -0,0 +1,238 @@
+/**
+ * The undo/redo history of a project. Pixel edits are recorded as compressed deltas of only the 16x16 tiles
+ * they changed, and frame and layer operations as the minimum needed to reverse them, so memory scales
+ * with how much was changed rather than with the size of the frames. The oldest entries are evicted once
+ * the history grows past its byte budget.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <deque>
+#include <vector>
+#include <QByteArray>
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+#include "sprite.h"
+
+class History
+{
+public:
+    static const int TILE_SIZE = Frame::TILE_SIZE;
+    static const qsizetype DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    enum class ChangeType {PIXELS, ADD_FRAME, INSERT_FRAME, DELETE_FRAME, DUPLICATE_FRAME,
+                           ADD_LAYER, INSERT_LAYER, DELETE_LAYER, SET_LAYER, TRANSFORM, PIXEL_BATCH, SET_PALETTE};
+
+    /**
+     * What an undo or redo did to the sprite, in terms of the sprite's own operations.
+     */
+    struct Change {
+        ChangeType type;
+        int frameIndex;        // The frame written to, added, inserted, deleted or duplicated
+        QVector<QPoint> tiles; // Top left corner of each tile written, for PIXELS
+        int layerIndex = 0;    // The layer written to, added, inserted, deleted or changed
+        int lastFrameIndex = 0;    // The last frame transformed or written to, for TRANSFORM and PIXEL_BATCH
+        FrameTransform transform;  // The transform applied, for TRANSFORM
+        std::vector<Change> parts; // The PIXELS changes of each layer written, for PIXEL_BATCH
+        QVector<int> paletteIndices; // The palette entries recolored, for SET_PALETTE
+        QRgb color = 0;              // The color they were given, for SET_PALETTE
+    };
+
+    /**
+     * Constructs an empty history.
+     * @param budget - the most bytes the recorded entries may use
+     */
+    History(qsizetype budget = DEFAULT_BUDGET);
+
+    /**
+     * Changes the byte budget, evicting the oldest entries if the history is now over it.
+     * @param budget - the most bytes the recorded entries may use
+     */
+    void setBudget(qsizetype budget);
+
+    /**
+     * Returns the number of bytes the recorded entries use.
+     */
+    qsizetype getUsedBytes() const;
+
+    /**
+     * Records a pixel edit of one layer by comparing the tiles of the layer before and after the edit. Tiles
+     * the edit never wrote to are still shared between the two and are skipped without comparing them.
+     * Nothing is recorded if no pixel changed.
+     * @param frameIndex - the edited frame
+     * @param layerIndex - the edited layer of the frame
+     * @param before - the layer's pixels before the edit
+     * @param after - the layer's pixels after the edit
+     * @param dirtyRect - the pixels which may have changed
+     */
+    void recordPixels(int frameIndex, int layerIndex, const Frame& before, const Frame& after, QRect dirtyRect);
+
+    /**
+     * Records a blank frame being added to the end of the sprite.
+     * @param frameIndex - the index of the new frame
+     */
+    void recordFrameAdded(int frameIndex);
+
+    /**
+     * Records a frame being deleted.
+     * @param frameIndex - the index the frame had
+     * @param frame - the deleted frame
+     * @param layers - the deleted frame's layers, if it had layers of its own
+     */
+    void recordFrameDeleted(int frameIndex, const Frame& frame, const QVector<Layer>& layers = {});
+
+    /**
+     * Records a frame being duplicated, the copy being inserted just after it.
+     * @param frameIndex - the index of the duplicated frame
+     */
+    void recordFrameDuplicated(int frameIndex);
+
+    /**
+     * Records a transparent layer being added to a frame.
+     * @param frameIndex - the frame
+     * @param layerIndex - the index of the new layer
+     */
+    void recordLayerAdded(int frameIndex, int layerIndex);
+
+    /**
+     * Records a layer being deleted. The layer is kept as it is, sharing its tiles with nothing else.
+     * @param frameIndex - the frame
+     * @param layerIndex - the index the layer had
+     * @param layer - the deleted layer
+     */
+    void recordLayerDeleted(int frameIndex, int layerIndex, const Layer& layer);
+
+    /**
+     * Records a layer's visibility, opacity or blend mode changing.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer
+     * @param before - the layer before the change
+     * @param after - the layer after the change
+     */
+    void recordLayerChanged(int frameIndex, int layerIndex, const Layer& before, const Layer& after);
+
+    /**
+     * Records a transform of a range of frames. Only the transform is kept, as its inverse undoes it.
+     * @param firstFrame - the first frame transformed
+     * @param lastFrame - the last frame transformed
+     * @param transform - the transform
+     */
+    void recordTransform(int firstFrame, int lastFrame, const FrameTransform& transform);
+
+    /**
+     * Records an edit of many frames at once as a single entry holding the changed tiles of each changed
+     * layer, which are compared and compressed on worker threads. Nothing is recorded if no pixel changed.
+     * @param edits - the frames' layers before and after the edit, as reported by the sprite
+     */
+    void recordFrameEdits(const QVector<Sprite::FrameEdit>& edits);
+
+    /**
+     * Records entries of an indexed sprite's palette being recolored. Undoing it does nothing once the
+     * sprite is no longer indexed.
+     * @param frameIndex - the frame shown when the palette changed
+     * @param indices - the palette entries recolored
+     * @param before - the color the entries had
+     * @param after - the color the entries were given
+     */
+    void recordPaletteColors(int frameIndex, const QVector<int>& indices, QRgb before, QRgb after);
+
+    /**
+     * Reverts the most recent entry.
+     * @param sprite - the sprite the entry was recorded on
+     * @param change - optionally receives what was done to the sprite
+     * @return int the frame the change was made to, or -1 if there was nothing to undo
+     */
+    int undo(Sprite& sprite, Change* change = nullptr);
+
+    /**
+     * Reapplies the most recently undone entry.
+     * @param sprite - the sprite the entry was recorded on
+     * @param change - optionally receives what was done to the sprite
+     * @return int the frame the change was made to, or -1 if there was nothing to redo
+     */
+    int redo(Sprite& sprite, Change* change = nullptr);
+
+    /**
+     * Returns if there is an entry to undo.
+     */
+    bool canUndo() const;
+
+    /**
+     * Returns if there is an undone entry to redo.
+     */
+    bool canRedo() const;
+
+    /**
+     * Forgets every entry, for when a different project is opened.
+     */
+    void clear();
+
+private:
+    enum class EntryType {PIXELS, ADD_FRAME, DELETE_FRAME, DUPLICATE_FRAME, ADD_LAYER, DELETE_LAYER, SET_LAYER, TRANSFORM, PIXEL_BATCH, SET_PALETTE};
+
+    struct Entry {
+        EntryType type;
+        int frameIndex;
+        QVector<QPoint> tiles; // Top left corner of each changed tile
+        QByteArray before;     // Compressed pixels of the tiles before the edit, or the deleted frame
+        QByteArray after;      // Compressed pixels of the tiles after the edit
+        int layerIndex = 0;
+        QVector<Layer> layers; // The deleted frame's or layer's layers, or a layer before then after a change
+        int lastFrameIndex = 0;
+        FrameTransform transform;
+        std::vector<Entry> parts; // A PIXELS entry for each layer of a PIXEL_BATCH
+        QVector<int> paletteIndices;
+        QRgb colorBefore = 0;
+        QRgb colorAfter = 0;
+
+        qsizetype cost() const;
+    };
+
+    std::deque<Entry> undoEntries;
+    std::vector<Entry> redoEntries;
+    qsizetype budget;
+    qsizetype usedBytes = 0;
+
+    /**
+     * Adds an entry to the undo stack, clearing the redo stack and evicting entries over the budget.
+     */
+    void push(Entry entry);
+
+    /**
+     * Removes the oldest entries until the history fits in its budget, always keeping the newest one.
+     */
+    void evict();
+
+    /**
+     * Builds a PIXELS entry of the tiles of a layer which changed, leaving its tiles empty if none did.
+     */
+    static Entry pixelEntry(int frameIndex, int layerIndex, const Frame& before, const Frame& after, QRect dirtyRect);
+
+    /**
+     * Appends the raw pixels of the rectangle of the frame, row by row, to the buffer.
+     */
+    static void appendTile(QByteArray& buffer, const Frame& frame, QRect tile);
+
+    /**
+     * Gives palette entries of an indexed sprite a color.
+     * @return true if the sprite is still indexed with every entry, so the entries were recolored
+     */
+    static bool setPaletteColors(Sprite& sprite, const QVector<int>& indices, QRgb color);
+
+    /**
+     * Writes compressed tiles recorded by recordPixels back into a layer of the sprite.
+     * @param sprite - the sprite to write into
+     * @param frameIndex - the frame to write into
+     * @param layerIndex - the layer of the frame to write into
+     * @param tiles - the top left corner of each tile
+     * @param compressed - the compressed pixels of the tiles
+     */
+    static void writeTiles(Sprite& sprite, int frameIndex, int layerIndex, const QVector<QPoint>& tiles, const QByteArray& compressed);
+};
+
+#endif // HISTORY_H
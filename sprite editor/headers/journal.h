@@ -0,0 +1,217 @@
+/**
+ * An append-only journal of the edits made to a project, so the project can be recovered after a crash.
+ * Each edit appends a compact binary record of only what it changed, so keeping the journal costs as much
+ * as the edits rather than the size of the project. Once the journal grows large it is compacted by
+ * writing a full snapshot of the sprite in the background and starting a new, empty journal.
+ *
+ * The directory holds numbered generations: snapshot-N.ssp and journal-N.log, where journal-N records the
+ * edits made after snapshot-N was taken. A generation's snapshot may still be being written when a later
+ * journal starts, so recovery loads the newest complete snapshot and replays every journal from it on.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QLockFile>
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include "history.h"
+#include "sprite.h"
+
+class Journal
+{
+public:
+    static const qint64 COMPACT_SIZE = 16 * 1024 * 1024; // Journal bytes after which a new snapshot is taken
+
+    /**
+     * Constructs a journal kept in the given directory. Journaling is disabled if another editor is already
+     * using the directory.
+     * @param directory - where the snapshots and journals are kept, created if it does not exist
+     */
+    Journal(const QString& directory);
+
+    /**
+     * Waits for any snapshot being written. The journal's files are left in place, for recovery.
+     */
+    ~Journal();
+
+    /**
+     * Returns if there is a project left behind by an editor which did not exit cleanly.
+     */
+    bool hasRecovery() const;
+
+    /**
+     * Loads the newest complete snapshot and replays the journals after it. A record cut short by the crash
+     * ends the replay.
+     * @return Sprite* the recovered sprite, or nullptr if there was nothing to recover
+     */
+    Sprite* recover() const;
+
+    /**
+     * Forgets every earlier generation and starts journaling a new project from a snapshot of the sprite.
+     * @param sprite - the project's sprite as it is now
+     */
+    void start(const Sprite& sprite);
+
+    /**
+     * Records a pixel edit of one layer. Like History::recordPixels, tiles the edit never wrote to are
+     * skipped without comparing them, and only the tiles' new pixels are recorded.
+     * @param frameIndex - the edited frame
+     * @param layerIndex - the edited layer of the frame
+     * @param before - the layer's pixels before the edit
+     * @param after - the layer's pixels after the edit
+     * @param dirtyRect - the pixels which may have changed
+     */
+    void recordPixels(int frameIndex, int layerIndex, const Frame& before, const Frame& after, QRect dirtyRect);
+
+    /**
+     * Records a blank frame being added to the end of the sprite.
+     */
+    void recordFrameAdded();
+
+    /**
+     * Records a frame being inserted.
+     * @param frameIndex - the index the new frame has
+     * @param frame - the inserted frame
+     */
+    void recordFrameInserted(int frameIndex, const Frame& frame);
+
+    /**
+     * Records a frame being deleted.
+     * @param frameIndex - the index the frame had
+     */
+    void recordFrameDeleted(int frameIndex);
+
+    /**
+     * Records a frame being duplicated, the copy being inserted just after it.
+     * @param frameIndex - the index of the duplicated frame
+     */
+    void recordFrameDuplicated(int frameIndex);
+
+    /**
+     * Records a color of an indexed sprite's palette being changed.
+     * @param index - the palette index
+     * @param color - the new ARGB32 color
+     */
+    void recordPaletteColor(int index, QRgb color);
+
+    /**
+     * Records a transparent layer being added to a frame.
+     * @param frameIndex - the frame
+     * @param layerIndex - the index of the new layer
+     */
+    void recordLayerAdded(int frameIndex, int layerIndex);
+
+    /**
+     * Records a layer being deleted.
+     * @param frameIndex - the frame
+     * @param layerIndex - the index the layer had
+     */
+    void recordLayerDeleted(int frameIndex, int layerIndex);
+
+    /**
+     * Records a layer's visibility, opacity or blend mode changing.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer
+     * @param layer - the layer after the change
+     */
+    void recordLayerChanged(int frameIndex, int layerIndex, const Layer& layer);
+
+    /**
+     * Records a transform of a range of frames.
+     * @param firstFrame - the first frame transformed
+     * @param lastFrame - the last frame transformed
+     * @param transform - the transform
+     */
+    void recordTransform(int firstFrame, int lastFrame, const FrameTransform& transform);
+
+    /**
+     * Records a color being replaced in a range of frames. Only the replacement is recorded, as replaying
+     * it gives the same pixels.
+     * @param firstFrame - the first frame recolored
+     * @param lastFrame - the last frame recolored
+     * @param from - the ARGB32 color replaced
+     * @param to - the ARGB32 color replacing it
+     * @param tolerance - the largest difference allowed in any one channel
+     */
+    void recordColorReplaced(int firstFrame, int lastFrame, QRgb from, QRgb to, int tolerance);
+
+    /**
+     * Records what an undo or redo did to the sprite.
+     * @param change - the change reported by History
+     * @param sprite - the sprite after the change
+     */
+    void recordChange(const History::Change& change, Sprite& sprite);
+
+    /**
+     * Starts a new generation from a snapshot of the sprite if the journal has grown past COMPACT_SIZE.
+     * @param sprite - the project's sprite as it is now
+     */
+    void compactIfLarge(const Sprite& sprite);
+
+    /**
+     * Stops journaling and deletes every snapshot and journal, for when the editor exits cleanly.
+     */
+    void discard();
+
+private:
+    enum class RecordType : quint8 {PIXELS = 1, ADD_FRAME, INSERT_FRAME, DELETE_FRAME, DUPLICATE_FRAME, SET_PALETTE_COLOR,
+                                    ADD_LAYER, DELETE_LAYER, SET_LAYER, TRANSFORM, REPLACE_COLOR};
+
+    static constexpr quint32 JOURNAL_MAGIC = 0x53534a32; // "SSJ2", whose pixel records name their layer
+
+    QDir directory;
+    QLockFile lock;
+    bool enabled;
+    QFile file;                // The journal of the newest generation
+    int generation = 0;
+    QThreadPool snapshotPool;  // Writes snapshots off the UI thread, one at a time
+
+    QString snapshotPath(int generation) const;
+    QString journalPath(int generation) const;
+
+    /**
+     * Returns the generations which have a file with the given prefix, in ascending order.
+     */
+    QVector<int> generations(const QString& prefix) const;
+
+    /**
+     * Opens the journal of a new generation and writes the snapshot it starts from in the background,
+     * deleting the older generations once the snapshot is complete.
+     */
+    void beginGeneration(const Sprite& sprite);
+
+    /**
+     * Appends one record to the journal in a single write and flushes it to the operating system.
+     */
+    void append(RecordType type, int frameIndex, const QByteArray& payload);
+
+    /**
+     * Packs the layer, then the corners and compressed little endian pixels of tiles of its pixels, into a
+     * record payload.
+     */
+    static QByteArray packTiles(int layerIndex, const Frame& frame, const QVector<QPoint>& tiles);
+
+    /**
+     * Applies the records of one journal to the sprite.
+     * @return true if every record was applied, false if the journal was cut short or invalid
+     */
+    static bool replay(Sprite& sprite, QIODevice& device, int generation);
+
+    /**
+     * Applies one record to the sprite.
+     * @return true if the record was valid for the sprite
+     */
+    static bool apply(Sprite& sprite, RecordType type, int frameIndex, const QByteArray& payload);
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,92 @@
+/**
+ * Records how long each stage between a mouse event and the canvas being repainted takes, along with how
+ * long each animation tick takes, and summarizes them as percentiles. Only the most recent samples of each
+ * stage are kept, so recording costs the same however long the editor runs.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class LatencyMonitor
+{
+public:
+    enum Stage {
+        INPUT,     // From the first mouse event of a batch until the batch is sent to be drawn
+        EDIT,      // The model applying a batch of input to the sprite
+        RENDER,    // Reading the changed pixels out of the frame and scaling them onto the canvas
+        PRESENT,   // From the canvas asking to be repainted until it has painted
+        TOTAL,     // From the first mouse event of a batch until the canvas has painted it
+        ANIMATION, // One tick of the animation preview
+        STAGE_COUNT
+    };
+
+    static const int CAPACITY = 1024; // Samples kept per stage
+
+    struct Summary {
+        int samples = 0;
+        double p50 = 0; // Milliseconds
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    LatencyMonitor();
+
+    /**
+     * Returns the current time in nanoseconds on the clock shared by everything recording into this monitor.
+     */
+    qint64 now() const;
+
+    /**
+     * Records one sample of a stage, replacing its oldest sample once CAPACITY are kept.
+     * @param stage - the stage
+     * @param nanoseconds - how long the stage took
+     */
+    void record(Stage stage, qint64 nanoseconds);
+
+    /**
+     * Records the time from start until now as one sample of a stage.
+     * @param stage - the stage
+     * @param start - when the stage started, from now()
+     */
+    void recordSince(Stage stage, qint64 start);
+
+    /**
+     * Returns the percentiles of the kept samples of a stage.
+     */
+    Summary summarize(Stage stage) const;
+
+    /**
+     * Returns a line per stage listing its percentiles, for the overlay and the log.
+     */
+    QStringList report() const;
+
+    /**
+     * Forgets every sample.
+     */
+    void clear();
+
+    /**
+     * Returns the name of a stage as shown in the report.
+     */
+    static QString stageName(Stage stage);
+
+private:
+    struct Samples {
+        QVector<qint64> values;
+        int next = 0; // Where the next sample goes once values is full
+    };
+
+    QElapsedTimer clock;
+    Samples stages[STAGE_COUNT];
+};
+
+#endif // LATENCYMONITOR_H
@@ -0,0 +1,127 @@
+/**
+ * The layers of one frame, bottom first, each with its own visibility, opacity and blend mode. The stack
+ * flattens its layers into the frame the rest of the editor shows and saves. While one layer is being
+ * drawn on, the layers below it and the layers above it are each kept composited, so an edit only has to
+ * composite the edited layer between the two and costs the same however many layers the frame has.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef LAYERSTACK_H
+#define LAYERSTACK_H
+
+#include "blend.h"
+#include "frame.h"
+#include <QRect>
+#include <QVector>
+
+/**
+ * One layer of a frame.
+ */
+struct Layer {
+    Frame pixels;         // Straight ARGB32, the size of the frame
+    bool visible = true;
+    quint8 opacity = 255;
+    BlendMode mode = BlendMode::SOURCE_OVER;
+
+    /**
+     * Returns if the layer shows its pixels exactly as they are, as a frame without layers does.
+     */
+    bool isPlain() const;
+};
+
+class LayerStack
+{
+public:
+    static const int MAX_LAYERS = 32; // The most layers a frame may have
+
+    /**
+     * Constructs an empty stack, as kept by frames which are a single plain layer.
+     */
+    LayerStack() = default;
+
+    /**
+     * Constructs a stack of the given layers.
+     * @param layers - the layers, bottom first
+     */
+    explicit LayerStack(const QVector<Layer>& layers);
+
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * Returns a layer, bottom first.
+     */
+    const Layer& at(int index) const;
+
+    const QVector<Layer>& getLayers() const;
+
+    /**
+     * Returns the pixels of a layer to draw on. Flatten must be called with the layer's index and the
+     * pixels changed afterwards.
+     * @param index - the layer
+     */
+    Frame& pixels(int index);
+
+    /**
+     * Inserts a layer, which must be the size of the stack's other layers.
+     * @param index - the index the new layer will have
+     * @param layer - the layer
+     */
+    void insert(int index, const Layer& layer);
+
+    /**
+     * Removes a layer.
+     * @param index - the layer to remove
+     */
+    void remove(int index);
+
+    /**
+     * Changes how a layer is composited.
+     * @param index - the layer
+     * @param visible - if the layer is shown
+     * @param opacity - how opaque the layer is, from 0 to 255
+     * @param mode - how the layer is composited onto the layers below it
+     */
+    void setProperties(int index, bool visible, quint8 opacity, BlendMode mode);
+
+    /**
+     * Composites the layers within a rectangle into the flattened frame.
+     * @param flattened - the frame receiving the straight ARGB32 result, the size of the layers
+     * @param rect - the pixels to composite
+     * @param editedLayer - the layer which changed, whose neighbors are then composited from the cache, or
+     *                      -1 to composite every layer
+     */
+    void flatten(Frame& flattened, QRect rect, int editedLayer = -1);
+
+    /**
+     * Drops the composites of the layers around the last edited layer, such as when the frame is left.
+     */
+    void dropCache();
+
+private:
+    QVector<Layer> layers;
+    int cachedLayer = -1; // The layer below and above were composited around
+    Frame below;          // The premultiplied composite of the layers under cachedLayer
+    Frame above;          // The premultiplied composite of the layers over cachedLayer, if aboveCached
+    bool aboveCached = false;
+
+    /**
+     * Composites the layers around a layer, for the edits to it which follow.
+     */
+    void cache(int layer);
+
+    /**
+     * Composites a range of layers onto one premultiplied row.
+     * @param line - the premultiplied row to composite onto
+     * @param first - the first layer
+     * @param last - the last layer
+     * @param x - the row's first column
+     * @param y - the row
+     * @param pixels - scratch space for a row of one layer, at least as long as the row
+     */
+    void compose(QVector<QRgb>& line, int first, int last, int x, int y, QVector<QRgb>& pixels) const;
+};
+
+#endif // LAYERSTACK_H
@@ -0,0 +1,133 @@
+/**
+ * Streaming reader for legacy JSON .ssp projects. The legacy format is an array of frames, each frame an
+ * array of {"red", "green", "blue", "alpha"} objects in column major order. The reader tokenizes the file
+ * in small chunks and decodes one frame at a time straight into QImage scanlines, so the JSON document is
+ * never held in memory as a whole.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef LEGACYPROJECTREADER_H
+#define LEGACYPROJECTREADER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+class LegacyProjectReader
+{
+private:
+    static const qint64 CHUNK_SIZE = 64 * 1024;
+
+    QIODevice& device;
+    QByteArray buffer;
+    qsizetype bufferPos = 0;
+    qint64 bufferStart = 0;
+
+    int width = 0;
+    int framesRead = 0;
+    bool finished = false;
+    QString error;
+
+    /**
+     * Reads the next chunk of the device into the buffer.
+     * @return false if the device has no more data
+     */
+    bool refill();
+
+    /**
+     * Looks at the next character without consuming it.
+     * @param c - set to the next character
+     * @return false at the end of the data
+     */
+    bool peek(char& c);
+
+    /**
+     * Consumes the next non whitespace character and checks that it is the expected one.
+     * @param expected - the character which must come next
+     * @return false (with the error set) if a different character was found
+     */
+    bool expect(char expected);
+
+    /**
+     * Skips over any JSON whitespace.
+     */
+    void skipWhitespace();
+
+    /**
+     * Reads a color object and packs it into a QRgb.
+     * @param pixel - set to the read color
+     * @return false (with the error set) if the object is malformed
+     */
+    bool readPixel(QRgb& pixel);
+
+    /**
+     * Reads one color channel value, which must be an integer from 0 to 255.
+     * @param value - set to the read value
+     * @return false (with the error set) if the value is malformed
+     */
+    bool readChannel(int& value);
+
+    /**
+     * Scans the first frame without decoding it to count its pixels, then rewinds the device.
+     * @param pixelCount - set to the number of pixels in the first frame
+     * @return false (with the error set) if the frame is malformed or the device cannot rewind
+     */
+    bool countFirstFrame(int& pixelCount);
+
+    /**
+     * Records an error message along with the current position in the file.
+     * @param message - what went wrong
+     * @return false, for convenience
+     */
+    bool fail(const QString& message);
+
+    /**
+     * The position of the next unread character in the device.
+     */
+    qint64 position() const;
+
+public:
+    /**
+     * Constructs a reader over the given device.
+     * @param device - an open, readable and seekable device positioned at the start of the project
+     */
+    LegacyProjectReader(QIODevice& device);
+
+    /**
+     * Reads the start of the project and validates the sprite's dimensions up front.
+     * @return false if the project is invalid, see errorString()
+     */
+    bool readHeader();
+
+    /**
+     * Decodes the next frame into the given image, validating its size and color values.
+     * @param image - set to the decoded frame
+     * @return false once there are no more frames or an error occured, see hasError()
+     */
+    bool readFrame(QImage& image);
+
+    /**
+     * Returns the width (and height) of the sprite, known after readHeader.
+     */
+    int getWidth() const;
+
+    /**
+     * Returns how far through the device the reader is, as a percentage.
+     */
+    int progress() const;
+
+    /**
+     * Returns if the project was found to be invalid.
+     */
+    bool hasError() const;
+
+    /**
+     * Returns a description of why the project is invalid.
+     */
+    QString errorString() const;
+};
+
+#endif // LEGACYPROJECTREADER_H
@@ -1,6 +1,6 @@
 /**
  * Represent the view of the sprite editor. Connects all of the slots and signals between the model and the view.
- * Sets the icons for each button and creates a new button for each new frome that is made. Handles the clicking of
+ * Sets the icons for each button and keeps the frame strip in step with the sprite's frames. Handles the clicking of
  * buttons and sends signals to the model to handle the clicks.
  *
  * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
@@ -14,10 +14,14 @@
 
 #include <QMainWindow>
 #include <QPoint>
+#include <QSize>
 #include <QImage>
 #include "model.h"
 #include "newfile.h"
-#include <QVBoxLayout>
+#include "previewcache.h"
+#include "framelistmodel.h"
+#include "latencymonitor.h"
+#include <QModelIndex>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -34,40 +38,55 @@ private:
     QColor currentColor;
     Model *model = nullptr;
     NewFile newFile;  //The dialog window.
-    QVBoxLayout *contentLayout; // The layout that holds all of the frame buttons.
-    QVector<QPushButton*> framesVector; // List of all the frame buttons.
+    FrameListModel *frameList; // The frames shown in the frame strip.
     int currentFrame = 1;
-    int spriteSize = 0;
+    QSize spriteSize;
 
     // Animation variables
     QTimer* animationTimer;
     int animationFPS = 5;
+    PreviewCache previewCache;
+
+    // Latency instrumentation
+    LatencyMonitor latency;
+    qint64 renderTime = 0; // Time spent drawing the canvas while the model handled the current input
 
     /**
      * Helper method that sets up the gui once a new file has been opened or loaded.
-     * @param spriteSize - the size inputed from the user.
+     * @param width - the sprite's width.
+     * @param height - the sprite's height.
      */
-    void setupView(int spriteSize);
+    void setupView(int width, int height);
+
+    /**
+     * Helper method that highlights a frame in the frame strip and shows its number under the canvas.
+     * @param frameID - the frame, counting from 1.
+     */
+    void showCurrentFrame(int frameID);
 
 public slots:
 
     /**
      * Sets up the inital properties of the view.
-     * @param spriteSize
+     * @param width - the width inputed from the user.
+     * @param height - the height inputed from the user.
      */
-    void setupNewView(int spriteSize); // TODO: RENAME TO setupNewView
+    void setupNewView(int width, int height);
 
     /**
      * Sets up the inital properties of the view.
-     * @param spriteSize
+     * @param width - the loaded sprite's width.
+     * @param height - the loaded sprite's height.
+     * @param frameCount - the number of frames the loaded sprite has.
      */
-    void setupLoadView(int spriteSize, int frameCount);
+    void setupLoadView(int width, int height, int frameCount);
 
     /**
-     * Converts canvas-relative input to sprite-relative input
-     * @param mousePos - the mouse position input
+     * Converts a batch of canvas-relative input to sprite-relative input
+     * @param mousePositions - the mouse positions input
+     * @param newStroke - if the first position is where the mouse was pressed
      */
-    void canvasInput(QPoint mousePos);
+    void canvasInput(const QVector<QPoint>& mousePositions, bool newStroke);
 
     /**
      * Opens the color pallet and allow a user to change the color. Will also change the color of the
@@ -76,16 +95,32 @@ public slots:
     void colorPickerClicked();
 
     /**
-     * Updates the main canvas to the image passed in.
-     * @param spriteImage - the image to be drawn.
+     * Updates the part of the main canvas covered by the dirty rectangle from the frame passed in.
+     * @param frame - the frame to be drawn.
+     * @param dirtyRect - the pixels of the frame which changed.
+     */
+    void canvasDraw(const Frame& frame, QRect dirtyRect);
+
+    /**
+     * Changes the image in the animation view and the real size animation view to the cached pixmaps of a
+     * frame, requesting the frame's image from the model if they are not cached.
+     * @param frameIndex - the frame to be drawn.
+     */
+    void animationDraw(int frameIndex);
+
+    /**
+     * Makes and caches the preview pixmaps of a frame.
+     * @param frameIndex - the frame.
+     * @param image - the frame's image.
      */
-    void canvasDraw(QImage spriteImage);
+    void cachePreview(int frameIndex, const QImage& image);
 
     /**
-     * Changes the image in the animation view and the real size animation view.
-     * @param spriteImage - the image to be drawn.
+     * Drops the cached preview pixmaps of frames which changed.
+     * @param firstFrame - the first changed frame.
+     * @param lastFrame - the last changed frame, or -1 for every frame after firstFrame.
      */
-    void animationDraw(QImage spriteImage);
+    void invalidatePreviews(int firstFrame, int lastFrame);
 
     /**
      * Tells the model that the tool has been changed to the brush tool and focuses the brush button.
@@ -127,8 +162,8 @@ public slots:
     void newFileOpened();
 
     /**
-     * Once the color picker has recognized a color, it will send a signal here to change the color
-     * of the colorPicker box.
+     * Once the color picker has recognized a color, it will send a signal here to make it the current color
+     * and change the color of the colorPicker box.
      * @param color
      */
     void updatedColor(QColor color);
@@ -156,6 +191,104 @@ public slots:
      */
     void loadButtonClicked();
 
+    /**
+     * Shows how far along loading a project is in the status bar.
+     * @param percent - how much of the project file has been read
+     */
+    void showLoadProgress(int percent);
+
+    /**
+     * Tells the user that a save has finished, or why it failed.
+     * @param path - the path the project was saved to
+     * @param error - why the save failed, empty if it succeeded
+     */
+    void showSaveResult(const QString& path, const QString& error);
+
+    /**
+     * Asks the user whether to recover the project left behind by an editor which crashed, if there is one.
+     */
+    void offerRecovery();
+
+    /**
+     * Updates the frame strip after undo or redo changed the sprite's frames.
+     * @param frameCount - the number of frames the sprite now has
+     * @param currentFrameIndex - the index of the frame now being shown
+     */
+    void syncFrames(int frameCount, int currentFrameIndex);
+
+    /**
+     * Tells the model to show the frame which was clicked in the frame strip.
+     * @param index - the clicked item.
+     */
+    void frameClicked(const QModelIndex& index);
+
+    /**
+     * Enables or disables the undo and redo actions.
+     * @param canUndo - if there is an edit to undo
+     * @param canRedo - if there is an undone edit to redo
+     */
+    void updateHistoryActions(bool canUndo, bool canRedo);
+
+    /**
+     * Asks the model for the next animation frame, timing how long the whole tick takes.
+     */
+    void animationTimerFired();
+
+    /**
+     * Logs the percentiles of every latency stage.
+     */
+    void logLatency();
+
+    /**
+     * Asks the model to switch the sprite to or from indexed color.
+     * @param indexed - if the sprite should be indexed
+     */
+    void indexedColorToggled(bool indexed);
+
+    /**
+     * Tells the user why the sprite could not be indexed.
+     * @param reason - why, from the model
+     */
+    void showIndexedModeError(const QString& reason);
+
+    /**
+     * Shows whether the sprite is indexed in the Image menu.
+     * @param indexed - if the sprite's frames store palette indices
+     */
+    void updateIndexedMode(bool indexed);
+
+    /**
+     * Opens the color picker to replace the palette entry of the current color, recoloring every frame.
+     */
+    void recolorPaletteClicked();
+
+    /**
+     * Shows the layers of the current frame and the properties of the current layer.
+     * @param layerCount - how many layers the current frame has
+     * @param currentLayer - the layer drawn on, bottom first
+     * @param visible - if the current layer is shown
+     * @param opacity - how opaque the current layer is, in percent
+     * @param mode - how the current layer is composited onto the layers below it
+     */
+    void updateLayers(int layerCount, int currentLayer, bool visible, int opacity, BlendMode mode);
+
+    /**
+     * Asks the model to transform the frames, all of them unless only the current one is checked.
+     * @param transform - the transform
+     */
+    void requestTransform(const FrameTransform& transform);
+
+    /**
+     * Asks how far to shift the frames, then shifts them.
+     */
+    void shiftClicked();
+
+    /**
+     * Asks what to replace the current color with, and how close a color must be to be replaced, then
+     * replaces it in the frames.
+     */
+    void replaceColorClicked();
+
 
 signals:
 
@@ -182,16 +315,24 @@ signals:
     void frameRemoved(int frameIndex);
 
     /**
-     * Emitted when mouse is pressed down in the canvas.
-     * @param pixelPos - the relative pixel position to the canvas.
+     * Emitted when mouse is pressed down or dragged in the canvas.
+     * @param pixelPositions - the relative pixel positions to the canvas.
+     * @param newStroke - if the first position is where the mouse was pressed.
      */
-    void sendPixelInput(QPoint pixelPos);
+    void sendPixelInput(const QVector<QPoint>& pixelPositions, bool newStroke);
 
     /**
      * Emitted once a new project is made.
-     * @param spriteSize - size inputed from the user.
+     * @param width - width inputed from the user.
+     * @param height - height inputed from the user.
      */
-    void setupModel(int spriteSize);
+    void setupModel(int width, int height);
+
+    /**
+     * Emitted when the preview pixmaps of a frame are needed but not cached.
+     * @param frameIndex - the frame.
+     */
+    void previewRequested(int frameIndex);
 
     /**
      * Emitted once a frame button is clicked.
@@ -223,6 +364,45 @@ signals:
      */
     void duplicateFrame(int frameIndex);
 
+    /**
+     * Emitted on every tick of the animation timer.
+     */
+    void animationTick();
+
+    /**
+     * Emitted when the user chooses to recover a crashed project.
+     */
+    void recoverProject();
+
+    /**
+     * Emitted when the user switches the sprite to or from indexed color.
+     * @param indexed - if the sprite should be indexed
+     */
+    void indexedModeRequested(bool indexed);
+
+    /**
+     * Emitted when the user recolors a palette entry.
+     * @param from - the color being replaced
+     * @param to - the new color
+     */
+    void paletteColorReplaced(QColor from, QColor to);
+
+    /**
+     * Emitted when the user picks a transform from the Image menu.
+     * @param transform - the transform
+     * @param currentFrameOnly - if only the current frame should be transformed
+     */
+    void transformRequested(FrameTransform transform, bool currentFrameOnly);
+
+    /**
+     * Emitted when the user replaces a color from the Image menu.
+     * @param from - the color to replace
+     * @param to - the color replacing it
+     * @param tolerance - the largest difference allowed in any one channel
+     * @param currentFrameOnly - if only the current frame should be recolored
+     */
+    void colorReplaceRequested(QColor from, QColor to, int tolerance, bool currentFrameOnly);
+
 public:
     MainWindow(Model* model, QWidget *parent = nullptr);
     ~MainWindow();
@@ -15,8 +15,17 @@
 #include <QObject>
 #include <QColor>
 #include <QPoint>
+#include <QRect>
+#include <QVector>
+#include <QImage>
+#include <QThreadPool>
 #include <filesystem>
 #include "sprite.h"
+#include "floodfill.h"
+#include "brush.h"
+#include "history.h"
+#include "journal.h"
+#include "onionskin.h"
 
 enum class Tool {PEN, ERASER, FILL, EYEDROPPER};
 
@@ -26,16 +35,113 @@ class Model : public QObject
 
 private:
     Sprite *sprite = nullptr;
+    QThreadPool thumbnailPool; // Makes frame strip thumbnails off the UI thread
+    QThreadPool savePool;      // Saves projects off the UI thread, one at a time
     Tool currentTool = Tool::PEN;
     QColor currentColor = QColor(Qt::black);
     int currentAnimationFrameIndex = 0;
+    int fillTolerance = 0;
+    Connectivity fillConnectivity = Connectivity::FOUR;
+    BlendMode blendMode = BlendMode::SOURCE_OVER;
+    Brush brush; // The pen and eraser's footprint
+    int currentLayer = 0; // The layer of the current frame the tools draw on
+    QPoint lastStrokePos; // The last pixel drawn by the current stroke
+
+    // Undo/redo
+    History history;
+    bool isEditing = false;
+    int editFrameIndex = 0;
+    int editLayerIndex = 0;
+    Frame editBefore; // The edited layer's pixels as they were when the stroke started
+    QRect editDirtyRect;
+
+    // Crash recovery
+    Journal journal;
+
+    OnionSkin onionSkin;
+
+    /**
+     * Starts recording a pixel edit of the current frame.
+     */
+    void beginEdit();
+
+    /**
+     * Records the pixel edit in progress, if any, as a single history entry.
+     */
+    void commitEdit();
+
+    /**
+     * Replaces the sprite with a loaded one, resetting the history and journal and showing it in the view.
+     * @param loadedSprite - the new sprite, which the model takes ownership of
+     */
+    void loadSprite(Sprite* loadedSprite);
+
+    /**
+     * Returns the pixels of the current layer of the current frame, for the tools to draw on.
+     */
+    Frame& layerPixels();
+
+    /**
+     * Flattens the dirty rectangle of the current layer into the current frame, adds it to the edit in
+     * progress and redraws it on the canvas.
+     * @param dirtyRect - the pixels of the current layer which changed
+     */
+    void frameEdited(QRect dirtyRect);
+
+    /**
+     * Keeps the current layer within the current frame's layers and emits layersChanged.
+     */
+    void updateLayers();
+
+    /**
+     * Shows a change to the layers of the current frame which may have changed all of it.
+     */
+    void layersEdited();
+
+    /**
+     * Changes how the current layer is composited, recording the change. Indexed sprites have no layers
+     * to change, so the view is only brought back in line with the layer.
+     * @param layer - the current layer with its new visibility, opacity and blend mode
+     */
+    void setLayer(const Layer& layer);
+
+    /**
+     * Shows the frame changed by an undo or redo and updates the view of the sprite's frames.
+     * @param frameIndex - the changed frame
+     * @param previousFrameCount - how many frames the sprite had before the undo or redo
+     * @param change - what the undo or redo did, when frameIndex is not -1
+     */
+    void historyApplied(int frameIndex, int previousFrameCount, const History::Change& change);
+
+    /**
+     * Invalidates the previews of the frames a transform changed.
+     * @param firstFrame - the first changed frame
+     * @param lastFrame - the last changed frame
+     * @param transform - the transform, whose recolor of an indexed sprite changes every frame
+     */
+    void framesTransformed(int firstFrame, int lastFrame, const FrameTransform& transform);
+
+    /**
+     * Brings the onion skin up to date with the frames around the current frame, emitting onionSkinChanged
+     * if it changed. Only the parts of neighboring frames drawn on since the last refresh are composited again.
+     * @return QRect the pixels of the onion skin which changed
+     */
+    QRect refreshOnionSkin();
+
+    /**
+     * Appends the pixels of the line between two points, excluding the start point, using Bresenham's algorithm.
+     * @param from - the start of the line
+     * @param to - the end of the line
+     * @param points - the list the line's pixels are appended to
+     */
+    static void appendLine(QPoint from, QPoint to, QVector<QPoint>& points);
 
     /**
-     * Replaces all recursively adjacent pixels of the clicked on pixels color to the currentColor
-     * @param x - starting x pos
-     * @param y - starting y pos
+     * Blends the currentColor onto all connected pixels within fillTolerance of the clicked on pixel's color
+     * @param pos - the pixel to start filling from
+     * @return QRect the bounding rectangle of the filled pixels
      */
-    void fillImage(QPoint pos);
+    QRect fillImage(QPoint pos);
 
 public:
     /**
@@ -43,14 +149,24 @@ public:
      * @param parent
      */
     Model(QObject *parent = nullptr);
+
+    /**
+     * Deletes the journal, as the editor is exiting cleanly.
+     */
     ~Model();
 
+    /**
+     * Returns if a project was left behind by an editor which crashed.
+     */
+    bool hasRecovery() const;
+
 signals:
     /**
      * Emitted when the sprite's frame's have been edited.
      * @param frame - the sprite's frame to be drawn
+     * @param dirtyRect - the pixels of the frame which changed
      */
-    void canvasDraw(QImage& frame);
+    void canvasDraw(const Frame& frame, QRect dirtyRect);
 
     /**
      * Emitted when the current color changes.
@@ -59,16 +175,94 @@ signals:
 
     /**
      * Emitted when the sprite animates to the next frame.
-     * @param frame - the frame in the animation which the sprite is now on
+     * @param frameIndex - the frame in the animation which the sprite is now on
      */
-    void animated(QImage& frame);
+    void animated(int frameIndex);
+
+    /**
+     * Emitted with the image of a frame for the animation preview, after it is requested.
+     * @param frameIndex - the frame
+     * @param image - the frame's image, shrunk if the frame is larger than Sprite::PREVIEW_SIZE
+     */
+    void previewReady(int frameIndex, const QImage& image);
+
+    /**
+     * Emitted when frames change, so their previews must be made again.
+     * @param firstFrame - the first changed frame
+     * @param lastFrame - the last changed frame, or -1 if every frame after firstFrame may have changed
+     */
+    void previewsInvalidated(int firstFrame, int lastFrame);
+
+    /**
+     * Emitted on the model's thread when a thumbnail made on a worker thread is ready.
+     * @param frameIndex - the frame
+     * @param revision - the revision passed to requestThumbnail
+     * @param thumbnail - the thumbnail
+     */
+    void thumbnailReady(int frameIndex, quint64 revision, const QImage& thumbnail);
 
     /**
      * Emitted after a project is deserialized.
-     * @param spriteSize - the sprite's size (note that sprites are square)
+     * @param width - the sprite's width
+     * @param height - the sprite's height
      * @param frameCount - the number of frames this sprite has
      */
-    void loadedProject(int spriteSize, int frameCount);
+    void loadedProject(int width, int height, int frameCount);
+
+    /**
+     * Emitted while a project is being deserialized.
+     * @param percent - how much of the project file has been read
+     */
+    void loadProgress(int percent);
+
+    /**
+     * Emitted on the model's thread once a save started by Serialize has finished.
+     * @param path - the path the project was saved to
+     * @param error - why the save failed, empty if it succeeded
+     */
+    void saveFinished(const QString& path, const QString& error);
+
+    /**
+     * Emitted when an undo or redo becomes possible or impossible.
+     * @param canUndo - if there is an edit to undo
+     * @param canRedo - if there is an undone edit to redo
+     */
+    void historyChanged(bool canUndo, bool canRedo);
+
+    /**
+     * Emitted when undo or redo changes the sprite's frames.
+     * @param frameCount - the number of frames the sprite now has
+     * @param currentFrameIndex - the index of the frame now being shown
+     */
+    void framesChanged(int frameCount, int currentFrameIndex);
+
+    /**
+     * Emitted when the onion skin shown beneath the current frame changes. The canvas is drawn again after.
+     * @param composite - the faded neighboring frames in premultiplied ARGB32, or a null frame for none
+     */
+    void onionSkinChanged(const Frame& composite);
+
+    /**
+     * Emitted when the layers of the current frame or the current layer change.
+     * @param layerCount - how many layers the current frame has
+     * @param currentLayer - the layer drawn on, bottom first
+     * @param visible - if the current layer is shown
+     * @param opacity - how opaque the current layer is, in percent
+     * @param mode - how the current layer is composited onto the layers below it
+     */
+    void layersChanged(int layerCount, int currentLayer, bool visible, int opacity, BlendMode mode);
+
+    /**
+     * Emitted when the sprite switches between indexed and ARGB32 colors, or a sprite is made or loaded.
+     * @param indexed - if the sprite's frames now store palette indices
+     */
+    void indexedModeChanged(bool indexed);
+
+    /**
+     * Emitted when the sprite could not be indexed.
+     * @param reason - why, to show to the user
+     */
+    void indexedModeFailed(const QString& reason);
 
 public slots:
     /**
@@ -77,6 +271,35 @@ public slots:
      */
     void editImage(QPoint pos);
 
+    /**
+     * Will edit the current frame with a batch of stroke input, connecting consecutive positions with lines
+     * and redrawing the canvas once for the whole batch.
+     * @param positions - the positions to draw, relative to the image
+     * @param newStroke - if the first position starts a new stroke rather than continuing the last one
+     */
+    void editStroke(const QVector<QPoint>& positions, bool newStroke);
+
+    /**
+     * Ends the current stroke, recording everything it changed as one undoable edit.
+     */
+    void endStroke();
+
+    /**
+     * Reverts the most recent edit or frame operation.
+     */
+    void undo();
+
+    /**
+     * Reapplies the most recently undone edit or frame operation.
+     */
+    void redo();
+
+    /**
+     * Changes how much memory the undo history may use before the oldest edits are forgotten.
+     * @param bytes - the history's budget in bytes
+     */
+    void setHistoryBudget(qsizetype bytes);
+
     /**
      * Will change the current tool selected by the user, which modifies what happens when a image pixel is clicked.
      * @param tool - the new tool
@@ -89,11 +312,105 @@ public slots:
      */
     void changeColor(QColor color);
 
+    /**
+     * Will change how the pen and fill tools composite the current color onto the pixels they draw on.
+     * @param mode - the new blend mode
+     */
+    void changeBlendMode(BlendMode mode);
+
+    /**
+     * Will change the width and height of the pen and eraser.
+     * @param size - the new size in pixels, from 1 to Brush::MAX_SIZE
+     */
+    void changeBrushSize(int size);
+
+    /**
+     * Will change the shape of the pen and eraser.
+     * @param shape - the new shape
+     */
+    void changeBrushShape(BrushShape shape);
+
+    /**
+     * Will change how many frames before and after the current frame are shown faded beneath it.
+     * @param frames - the number of frames on each side, from 0 (none) to OnionSkin::MAX_RANGE
+     */
+    void changeOnionSkinRange(int frames);
+
+    /**
+     * Adds a transparent layer just above the current layer of the current frame and draws on it. Indexed
+     * sprites cannot have layers.
+     */
+    void addLayer();
+
+    /**
+     * Deletes the current layer of the current frame, unless it is the frame's only layer.
+     */
+    void deleteLayer();
+
+    /**
+     * Will change which layer of the current frame the tools draw on.
+     * @param layerIndex - the layer, bottom first
+     */
+    void selectLayer(int layerIndex);
+
+    /**
+     * Will show or hide the current layer.
+     * @param visible - if the layer is shown
+     */
+    void setLayerVisible(bool visible);
+
+    /**
+     * Will change how opaque the current layer is.
+     * @param percent - the opacity, from 0 to 100
+     */
+    void setLayerOpacity(int percent);
+
+    /**
+     * Will change how the current layer is composited onto the layers below it.
+     * @param mode - the new blend mode
+     */
+    void setLayerBlendMode(BlendMode mode);
+
+    /**
+     * Transforms every frame, or only the current one, as a single undoable operation. Quarter turns need a
+     * square sprite, as every frame of a sprite has the same size.
+     * @param transform - the transform
+     * @param currentFrameOnly - if only the current frame is transformed
+     */
+    void transformFrames(FrameTransform transform, bool currentFrameOnly);
+
+    /**
+     * Replaces a color in every frame, or only the current one, as a single undoable operation.
+     * @param from - the color to replace
+     * @param to - the color replacing it
+     * @param tolerance - the largest difference allowed in any one channel, from 0 (exact) to 255
+     * @param currentFrameOnly - if only the current frame is recolored
+     */
+    void replaceColor(QColor from, QColor to, int tolerance, bool currentFrameOnly);
+
+    /**
+     * Will change how far a pixel's color can be from the clicked on color and still be filled.
+     * @param tolerance - the largest difference allowed in any one channel, from 0 (exact) to 255
+     */
+    void changeFillTolerance(int tolerance);
+
+    /**
+     * Will change if the fill tool spreads to diagonal neighbors.
+     * @param connectivity - the new connectivity
+     */
+    void changeFillConnectivity(Connectivity connectivity);
+
     /**
      * Sets up this project's sprite with the given size.
-     * @param size - the width/height of the sprite's frame
+     * @param width - the width of the sprite's frames
+     * @param height - the height of the sprite's frames
      */
-    void setupSprite(int size);
+    void setupSprite(int width, int height);
+
+    /**
+     * Emits canvasDraw for the whole current frame, for when the canvas has scrolled or zoomed.
+     */
+    void redrawCanvas();
 
     /**
      * Makes a new frame in the sprite.
@@ -124,16 +441,58 @@ public slots:
     void animateNextFrame();
 
     /**
-     * Serializes the project into JSON format.
+     * Emits previewReady with the image of a frame. Frames larger than Sprite::PREVIEW_SIZE are shrunk first.
+     * @param frameIndex - the frame
+     */
+    void requestPreview(int frameIndex);
+
+    /**
+     * Makes a thumbnail of a frame on a worker thread and emits thumbnailReady with it. The worker draws from
+     * a copy of the frame, which shares its tiles, so drawing on the frame meanwhile is safe.
+     * @param frameIndex - the frame
+     * @param revision - identifies the state of the frame, passed back with the thumbnail
+     * @param size - the largest width and height of the thumbnail
+     */
+    void requestThumbnail(int frameIndex, quint64 revision, int size);
+
+    /**
+     * Serializes the project into the binary .ssp v2 format on a worker thread, then emits saveFinished.
+     * The worker writes a snapshot of the sprite taken when this is called, so editing can continue while
+     * it saves. The file is written under a temporary name and renamed over the path once complete, so an
+     * existing project is never left half written. Saves happen one at a time in the order requested.
      * @param path - the path to serialize to
      */
     void Serialize(QString path); // std::filesystem::path path
 
     /**
-     * Deserializes a .ssp file into the project.
+     * Opens a .ssp file as the project, decoding frames only as they are used. Legacy JSON projects are
+     * imported as well.
      * @param path - the path of the .ssp file to deserialize
      */
     void Deserialize(QString path); // td::filesystem::path path
+
+    /**
+     * Loads the project left behind by an editor which crashed, replaying its journal.
+     */
+    void recover();
+
+    /**
+     * Converts the sprite to palette indices or back to ARGB32 colors, then emits indexedModeChanged. A
+     * sprite using more colors than a palette holds, or with layers, stays ARGB32 and indexedModeFailed says
+     * why. Indexing clears the history, as undoing could bring layers back. Converting back to ARGB32 keeps
+     * it, as its edits are recorded as colors.
+     * @param indexed - if the sprite should be indexed
+     */
+    void setIndexedMode(bool indexed);
+
+    /**
+     * Changes a color of an indexed sprite's palette, recoloring it across every frame at once as a single
+     * undoable operation. Every palette entry holding the old color changes, and nothing does if none holds
+     * it exactly.
+     * @param from - the color to replace
+     * @param to - the new color
+     */
+    void replacePaletteColor(QColor from, QColor to);
 };
 
 #endif // MODEL_H
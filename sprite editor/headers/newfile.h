@@ -11,6 +11,7 @@
 #define NEWFILE_H
 
 #include <QDialog>
+#include "sprite.h"
 
 namespace Ui {
 class NewFile;
@@ -30,7 +31,8 @@ private:
 private slots:
 
     /**
-     * If okay is accepted, send the size entered to the main view and close this page.
+     * If okay is accepted, send the size entered to the main view and close this page. The height defaults to
+     * the width when left empty.
      */
     void confirmButtonClicked();
 
@@ -48,9 +50,10 @@ signals:
 
     /**
      *Sends the size entered from the user to the main view.
-     * @param size - size of the canvas inputed from the user.
+     * @param width - width of the canvas inputed from the user.
+     * @param height - height of the canvas inputed from the user.
      */
-    void sendSize(int size);
+    void sendSize(int width, int height);
 };
 
 
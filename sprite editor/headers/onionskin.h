@@ -0,0 +1,57 @@
+/**
+ * The frames before and after the current one, faded with distance and composited into a single image the
+ * canvas shows beneath the current frame. The composite is kept between updates along with copies of the
+ * frames it was made from, and only the tiles where a neighbor no longer shares its tile with its copy are
+ * composited again, so drawing on or flipping between frames which share most of their tiles stays cheap.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef ONIONSKIN_H
+#define ONIONSKIN_H
+
+#include "frame.h"
+#include "sprite.h"
+#include <QRect>
+#include <QVector>
+
+class OnionSkin
+{
+public:
+    static const int MAX_RANGE = 8;   // The most frames shown on each side of the current frame
+    static const uint OPACITY = 128;  // How opaque the nearest neighbors are drawn, from 0 to 255
+
+    /**
+     * Sets how many frames before and after the current frame are shown. Takes effect on the next update.
+     * @param frames - the number of frames on each side, from 0 (no onion skin) to MAX_RANGE
+     */
+    void setRange(int frames);
+
+    int getRange() const;
+
+    /**
+     * Returns the composite of the neighboring frames, which holds premultiplied pixels rather than the
+     * straight ARGB32 of a sprite's frames. It is null while the range is 0.
+     */
+    const Frame& getComposite() const;
+
+    /**
+     * Brings the composite up to date with the frames around the sprite's current frame.
+     * @param sprite - the sprite
+     * @return QRect the pixels of the composite which changed
+     */
+    QRect update(Sprite& sprite);
+
+private:
+    int range = 0;
+    Frame composite;
+    QVector<Frame> neighbors; // The frames the composite was made from, two per distance: before then after
+
+    /**
+     * Returns how opaque the frames at a distance from the current frame are drawn, from 0 to 255.
+     */
+    uint opacity(int distance) const;
+};
+
+#endif // ONIONSKIN_H
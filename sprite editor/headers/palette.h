@@ -0,0 +1,76 @@
+/**
+ * A palette of up to 256 colors for indexed frames. Copying a palette is cheap, as its tables are shared
+ * until one of the copies is changed, so every frame of a sprite can hold its own copy.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <QColor>
+#include <QHash>
+#include <QVector>
+
+class Palette
+{
+public:
+    static const int MAX_COLORS = 256;
+
+    /**
+     * Constructs a palette holding only transparent.
+     */
+    Palette();
+
+    /**
+     * Constructs a palette from a list of colors.
+     * @param colors - the colors, at most MAX_COLORS of them
+     */
+    explicit Palette(const QVector<QRgb>& colors);
+
+    /**
+     * Returns the number of colors in the palette.
+     */
+    int size() const;
+
+    /**
+     * Returns the color at an index. Indices past the end of the palette are transparent.
+     * @param index - the index
+     */
+    QRgb color(quint8 index) const;
+
+    /**
+     * Changes the color at an index, which must be inside the palette.
+     * @param index - the index
+     * @param color - the new ARGB32 color
+     */
+    void setColor(int index, QRgb color);
+
+    /**
+     * Returns the index of a color, or of the closest color in the palette if it is not in it.
+     * @param color - the ARGB32 color
+     */
+    quint8 indexOf(QRgb color) const;
+
+    /**
+     * Returns the indices holding exactly the given color.
+     */
+    QVector<int> indicesOf(QRgb color) const;
+
+    bool operator==(const Palette& other) const;
+    bool operator!=(const Palette& other) const;
+
+private:
+    QVector<QRgb> colors; // Always MAX_COLORS long, so any quint8 is a valid index
+    int count = 0;
+    QHash<QRgb, int> lookup; // The first index of each color
+
+    void rebuildLookup();
+};
+
+inline QRgb Palette::color(quint8 index) const{
+    return colors.at(index);
+}
+
+#endif // PALETTE_H
@@ -0,0 +1,69 @@
+/**
+ * Ready to display pixmaps of each frame for the animation preview, so playing the preview only has to hand a
+ * cached pixmap to each label. Entries are dropped when their frame changes or the preview is resized, and
+ * the least recently shown ones are evicted once the cache grows past its byte budget.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+
+class PreviewCache
+{
+public:
+    static const qsizetype DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    /**
+     * The pixmaps shown for one frame.
+     */
+    struct Entry {
+        QPixmap scaled;   // Scaled to fit the zoomed preview
+        QPixmap realSize; // One pixel per sprite pixel
+    };
+
+    /**
+     * Constructs an empty cache.
+     * @param budget - the most bytes the cached pixmaps may use
+     */
+    PreviewCache(qsizetype budget = DEFAULT_BUDGET);
+
+    /**
+     * Sets the size the scaled pixmaps are made to fit, dropping every entry if it changed.
+     * @param size - the size of the zoomed preview
+     */
+    void setScaledSize(QSize size);
+
+    /**
+     * Gets the cached pixmaps of a frame.
+     * @param frameIndex - the frame
+     * @return const Entry* the pixmaps, or nullptr if the frame is not cached
+     */
+    const Entry* find(int frameIndex) const;
+
+    /**
+     * Makes and caches the pixmaps of a frame.
+     * @param frameIndex - the frame
+     * @param image - the frame's image
+     */
+    void insert(int frameIndex, const QImage& image);
+
+    /**
+     * Drops the entries of a range of frames.
+     * @param firstFrame - the first frame to drop
+     * @param lastFrame - the last frame to drop, or -1 for every frame after firstFrame
+     */
+    void invalidate(int firstFrame, int lastFrame);
+
+private:
+    QSize scaledSize;
+    QCache<int, Entry> entries;
+};
+
+#endif // PREVIEWCACHE_H
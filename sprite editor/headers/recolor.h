@@ -0,0 +1,48 @@
+/**
+ * Replaces one color with another wherever it appears, exactly or within a tolerance on every channel. Each
+ * pixel is split into red and blue in one word and alpha and green in another, each channel in a 16-bit lane,
+ * so one subtraction and one mask test two channels against the tolerance at once. Frames are recolored a
+ * tile at a time and only the tiles holding the color are written, so tiles shared with other frames stay
+ * shared elsewhere.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef RECOLOR_H
+#define RECOLOR_H
+
+#include "frame.h"
+
+class Recolor
+{
+public:
+    /**
+     * Returns if every channel of a pixel is within the tolerance of the target color's.
+     */
+    static bool matches(QRgb pixel, QRgb target, int tolerance);
+
+    /**
+     * Replaces the pixels of a span which match a color.
+     * @param pixels - the count straight ARGB32 pixels, which receive the result
+     * @param count - the number of pixels
+     * @param from - the color to replace
+     * @param to - the color replacing it
+     * @param tolerance - the largest difference allowed in any one channel, from 0 (exact) to 255
+     * @return int the number of pixels which changed
+     */
+    static int replaceSpan(QRgb* pixels, int count, QRgb from, QRgb to, int tolerance);
+
+    /**
+     * Replaces a color throughout a frame. An indexed frame has the indices of every palette entry matching
+     * the color replaced by the entry closest to the new color, so it stays indexed.
+     * @param frame - the frame to recolor
+     * @param from - the color to replace
+     * @param to - the color replacing it
+     * @param tolerance - the largest difference allowed in any one channel, from 0 (exact) to 255
+     * @return true if any pixel changed
+     */
+    static bool replace(Frame& frame, QRgb from, QRgb to, int tolerance);
+};
+
+#endif // RECOLOR_H
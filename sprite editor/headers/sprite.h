@@ -3,7 +3,7 @@
 
 /**
  * File representing a Sprite object.
- * A Sprite can contain multiple frames as QImage objects.
+ * A Sprite can contain multiple frames as copy on write tiled Frame objects.
  * You can add and remove frames, as well as save/load sprites to/from files
  *
  * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
@@ -13,31 +13,144 @@
  **/
 
 #include <vector>
+#include <functional>
+#include <memory>
 #include <QColor>
 #include <QImage>
 #include <QPoint>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonDocument>
+#include <QRect>
+#include <QVector>
+#include <QIODevice>
+#include <QDataStream>
 #include "frame.h"
+#include "layerstack.h"
+#include "transform.h"
 using std::vector;
 
 /**
- * Represents a Sprite object; a small pixelated image or animation.
+ * Represents a Sprite object; a small pixelated image or animation. Copying a sprite is cheap, as the copy
+ * shares every tile with the original until either is drawn on, which makes copies usable as snapshots.
+ *
+ * A sprite opened with Open reads only where each frame is stored, and decodes frames from the memory
+ * mapped file the first time they are used. Decoded frames which have not been drawn on are kept in a
+ * least recently used cache of FRAME_CACHE_BYTES and decoded again if they are needed after being dropped.
+ * A frame which has been drawn on stays in memory like any new frame.
+ *
+ * Projects store most frames as the tiles which changed since the frame before, with a keyframe holding a
+ * whole frame at least every KEYFRAME_INTERVAL frames. Decoding a frame then starts from the frame before
+ * if it is still decoded, or else from the keyframe before it.
+ *
+ * A frame may have layers, in which case the frame itself is their flattened result and is kept up to date
+ * as they change. Tools draw on a layer's pixels, never on such a frame. A frame without layers of its own
+ * is a single plain layer, which is the frame itself, so frames only pay for layers once they use them.
  */
 class Sprite{
 private:
+    /**
+     * The memory mapped project file frames are decoded from, shared by every copy of the sprite.
+     */
+    struct FrameSource;
+
+    /**
+     * One frame of the sprite, which may not have been decoded from the source yet.
+     */
+    struct StoredFrame {
+        Frame frame;        // Null while the frame is not decoded, the flattened layers if it has them
+        LayerStack layers;  // Empty while the frame is a single plain layer
+        Frame decoded;      // The frame as it was decoded, to tell if it has been drawn on since
+        int chunk = -1;     // The index of the frame's chunk in the source, -1 if the frame only lives in memory
+        quint64 lastUsed = 0;
+    };
+
     int width;
-    vector<QImage> frames;
+    int height;
+    mutable vector<StoredFrame> frames; // Decoded on demand, even by const methods
+    mutable quint64 useClock = 0;
     int currentFrameIndex = 0;
+    bool indexed = false;
+    Palette palette;
+    std::shared_ptr<const FrameSource> source;
+
+    /**
+     * Returns a frame, decoding it first if it is not in memory. The reference stays valid until another
+     * frame is decoded or the frames change.
+     * @param index - the frame, which must exist
+     */
+    Frame& frameAt(int index) const;
+
+    /**
+     * Drops the least recently used decoded frames until the cache fits in FRAME_CACHE_BYTES. Frames found
+     * to have been drawn on leave the cache and stay in memory.
+     * @param keep - a frame which must not be dropped, as it was just decoded
+     */
+    void evictFrames(int keep) const;
+
+    /**
+     * Makes a frame live only in memory, for when it is about to be replaced.
+     */
+    static void detachFrame(StoredFrame& stored);
+
+    /**
+     * Returns the layers of a frame to change, first giving a frame without layers of its own a stack
+     * holding it as the only layer. The frame then lives only in memory.
+     * @param frameIndex - the frame, which must exist
+     */
+    LayerStack& layerStack(int frameIndex);
+
+    /**
+     * Flattens every layer of a frame into it, and drops the stack if only a single plain layer is left.
+     * @param frameIndex - the frame, which must exist
+     */
+    void flattenLayers(int frameIndex);
+
+public:
+    /**
+     * The layers of one frame before and after an edit of many frames at once. A frame without layers of its
+     * own is given as its only layer.
+     */
+    struct FrameEdit {
+        int frameIndex = 0;
+        QVector<Layer> before;
+        QVector<Layer> after;
+    };
+
+private:
+    /**
+     * Updates a range of frames on worker threads, decoding frames not in memory yet on the workers too. A
+     * frame which shares all its tiles with the one before it is updated once for both. Frames with layers
+     * are flattened again after the update, and only frames which changed replace their sources.
+     * @param firstFrame - the first frame to update
+     * @param lastFrame - the last frame to update
+     * @param update - changes the layers of a frame, bottom first, returning if anything changed; called on
+     * any thread, and never with an empty list
+     * @return QVector<FrameEdit> the frames which changed
+     */
+    QVector<FrameEdit> updateFrames(int firstFrame, int lastFrame, const std::function<bool(QVector<Layer>& layers)>& update);
 
 public:
+    /**
+     * Runs a task for each index from 0 to count - 1 on the global thread pool, the calling thread working
+     * alongside it, and returns once every task has run.
+     * @param count - the number of tasks
+     * @param task - called with each index, on any thread
+     */
+    static void parallelFor(int count, const std::function<void(int index)>& task);
+
+    /**
+     * Called while a project loads with how far through the file it is, as a percentage.
+     */
+    using ProgressCallback = std::function<void(int percent)>;
+
+    static const int MAX_SIZE = 8192; // The largest width or height of a sprite
+    static const int PREVIEW_SIZE = 256; // Larger frames are shrunk to this before being sent to the animation preview
+    static const qint64 FRAME_CACHE_BYTES = 256 * 1024 * 1024; // Decoded, unchanged frames kept from the source
 
     /**
      * Constructs a Sprite object
      * @param width - the width of this sprite in pixels
+     * @param height - the height of this sprite in pixels
      */
-    Sprite(int width);
+    Sprite(int width, int height);
 
     /**
      * Destructor for a sprite.
@@ -45,19 +158,64 @@ public:
     ~Sprite();
 
     /**
-     * Sets the color of a pixel at the given x y position in current frame.
+     * Opens a .ssp project, reading only the header and where each frame is stored, so opening costs the
+     * same however many frames there are. Frames are decoded the first time they are used. Projects which
+     * cannot be memory mapped, and legacy JSON projects, are deserialized up front instead.
+     * @param path - the project file
+     * @param progress - optionally called while a project is deserialized up front
+     * @return Sprite* the opened sprite, or nullptr if the file is not a valid project
+     */
+    static Sprite* Open(const QString& path, const ProgressCallback& progress = nullptr);
+
+    /**
+     * Returns if frames are still decoded from the given file, meaning it must not be replaced on systems
+     * which cannot replace a mapped file.
+     */
+    bool isOpenedFrom(const QString& path) const;
+
+    /**
+     * Decodes every frame which is not in memory and stops reading from the opened file.
+     */
+    void detachSource();
+
+    /**
+     * Returns if the given position lies inside the sprite.
      * @param pos - The point
-     * @param color - the color to set the pixel to
+     * @return true if the position is a pixel of the sprite
+     */
+    bool contains(QPoint pos) const;
+
+    /**
+     * Sets the color of a pixel at the given x y position in current frame. Positions outside the sprite
+     * are ignored.
+     * @param pos - The point
+     * @param color - the ARGB32 color to set the pixel to
+     */
+    void setPixel(QPoint pos, QRgb color);
+
+    /**
+     * Sets every given pixel in the current frame to one color. Positions outside the sprite are ignored.
+     * @param points - the pixels to set
+     * @param color - the ARGB32 color to set the pixels to
+     * @return QRect the bounding rectangle of the pixels which were set
      */
-    void setPixel(QPoint pos, QColor color);
+    QRect setPixels(const QVector<QPoint>& points, QRgb color);
+
+    /**
+     * Fills a rectangle of the current frame with one color, clipped to the sprite.
+     * @param rect - the rectangle to fill
+     * @param color - the ARGB32 color to fill with
+     * @return QRect the part of the rectangle which was filled
+     */
+    QRect fillRect(QRect rect, QRgb color);
 
     /**
      * Retrieves the color of the pixel at the given position on this Sprite's
      * current frame.
      * @param pos - The point
-     * @return QColor pixel color
+     * @return QRgb ARGB32 pixel color, transparent for positions outside the sprite
      */
-    QColor getColor(QPoint pos);
+    QRgb getPixel(QPoint pos) const;
 
     /**
      * Adds a new blank white frame to this sprite.
@@ -74,17 +232,38 @@ public:
 
     /**
      * Gets the current frame according to the currentFrameIndex
-     * @return QImage reference to the current frame
+     * @return Frame reference to the current frame
      */
-    QImage& getFrame();
+    Frame& getFrame();
 
     /**
      * Gets the chosen frame according to the input
      * @param frame - the frame to return
      * @param setCurrent - if the frame selected should become the current frame (default = false)
-     * @return QImage reference to the chosen frameva
+     * @return Frame reference to the chosen frame
+     */
+    Frame& getFrame(int frame, bool setCurrent);
+
+    /**
+     * Gets the index of the current frame
+     * @return int currentFrameIndex
+     */
+    int getCurrentFrameIndex();
+
+    /**
+     * Inserts a frame into this sprite. The frame's dimensions must match the sprite's width and height.
+     * @param index - the index the new frame will have
+     * @param frame - the frame to insert, which keeps sharing its tiles with wherever it was copied from
      */
-    QImage& getFrame(int frame, bool setCurrent);
+    void insertFrame(int index, const Frame& frame);
+
+    /**
+     * Inserts a frame made of layers into this sprite, flattening them into it. An indexed sprite gets the
+     * flattened frame alone, converted to its palette, as indexed sprites have no layers.
+     * @param index - the index the new frame will have
+     * @param layers - the frame's layers, bottom first, which must not be empty
+     */
+    void insertFrame(int index, const QVector<Layer>& layers);
 
     /**
      * Deletes the current frame according to the currentFrameIndex
@@ -98,17 +277,122 @@ public:
     void deleteFrame(int frame);
 
     /**
-     * @brief Duplicate the frame of certain index.
+     * @brief Duplicate the frame of certain index. The copy shares every tile with the original until either
+     * is drawn on.
      * @param frameIndex - the frame to duplicate
      */
     void duplicateFrame(int frameIndex);
 
     /**
-     * Returns the int pixel width (and also height of the sprite.
+     * Returns how many layers a frame has. A frame without layers of its own is a single layer.
+     * @param frameIndex - the frame
+     */
+    int getLayerCount(int frameIndex) const;
+
+    /**
+     * Returns a layer of a frame, whose pixels share their tiles with the layer's own.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer, bottom first
+     */
+    Layer getLayer(int frameIndex, int layerIndex) const;
+
+    /**
+     * Returns every layer of a frame, bottom first, or none if the frame is a single plain layer.
+     * @param frameIndex - the frame
+     */
+    QVector<Layer> getLayers(int frameIndex) const;
+
+    /**
+     * Returns the pixels of a layer to draw on. layerEdited must be called with the pixels changed once
+     * the drawing is done, so the frame shows them.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer
+     * @return Frame reference to the layer's pixels, which is the frame itself if it has no layers of its own
+     */
+    Frame& getLayerPixels(int frameIndex, int layerIndex);
+
+    /**
+     * Flattens the changed pixels of a layer into its frame. Only the changed layer is composited, between
+     * composites of the layers below and above it kept from the previous edit of the same layer.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer drawn on
+     * @param dirtyRect - the pixels of the layer which changed
+     * @return QRect the pixels of the frame which may have changed
+     */
+    QRect layerEdited(int frameIndex, int layerIndex, QRect dirtyRect);
+
+    /**
+     * Adds a transparent layer to a frame. Indexed sprites cannot have layers, and a frame has at most
+     * LayerStack::MAX_LAYERS.
+     * @param frameIndex - the frame
+     * @param layerIndex - the index the new layer will have
+     * @return true if the layer was added
+     */
+    bool addLayer(int frameIndex, int layerIndex);
+
+    /**
+     * Inserts a layer into a frame, such as one restored from the history. Like addLayer, nothing changes if
+     * the sprite is indexed or the frame already has LayerStack::MAX_LAYERS.
+     * @param frameIndex - the frame
+     * @param layerIndex - the index the layer will have
+     * @param layer - the layer, the size of the sprite
+     * @return true if the layer was inserted
+     */
+    bool insertLayer(int frameIndex, int layerIndex, const Layer& layer);
+
+    /**
+     * Deletes a layer of a frame which has more than one.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer to delete
+     */
+    void deleteLayer(int frameIndex, int layerIndex);
+
+    /**
+     * Changes how a layer of a frame is composited.
+     * @param frameIndex - the frame
+     * @param layerIndex - the layer
+     * @param visible - if the layer is shown
+     * @param opacity - how opaque the layer is, from 0 to 255
+     * @param mode - how the layer is composited onto the layers below it
+     */
+    void setLayerProperties(int frameIndex, int layerIndex, bool visible, quint8 opacity, BlendMode mode);
+
+    /**
+     * Transforms a range of frames and every layer of them, each frame on its own worker thread. Frames not
+     * decoded yet are decoded by the workers, and a frame which shares all its tiles with the one before it
+     * is transformed once for both. Inverting the colors of an indexed sprite inverts its palette instead,
+     * which recolors every frame.
+     * @param firstFrame - the first frame to transform
+     * @param lastFrame - the last frame to transform
+     * @param transform - the transform
+     * @return true if the frames were transformed, false for a quarter turn of a sprite which is not square
+     */
+    bool transformFrames(int firstFrame, int lastFrame, const FrameTransform& transform);
+
+    /**
+     * Replaces a color in every layer of a range of frames, each frame on its own worker thread. An indexed
+     * sprite has the color replaced by the palette entry closest to the new color, as its palette is kept.
+     * @param firstFrame - the first frame to recolor
+     * @param lastFrame - the last frame to recolor
+     * @param from - the ARGB32 color to replace
+     * @param to - the ARGB32 color replacing it
+     * @param tolerance - the largest difference allowed in any one channel, from 0 (exact) to 255
+     * @return QVector<FrameEdit> the frames which changed, for the history
+     */
+    QVector<FrameEdit> replaceColor(int firstFrame, int lastFrame, QRgb from, QRgb to, int tolerance);
+
+    /**
+     * Returns the int pixel width of the sprite.
      * @return int pixel length
      */
     int getWidth();
 
+    /**
+     * Returns the int pixel height of the sprite.
+     * @return int pixel length
+     */
+    int getHeight();
+
     /**
      * Returns the amount of frames contained in the sprite
      * @return int frame count
@@ -116,17 +400,144 @@ public:
     int getFrameCount();
 
     /**
-     * Serializes the sprite into JSON
-     * @return QString JSON representation of the sprite
+     * Returns if the sprite's frames store palette indices rather than colors.
+     */
+    bool isIndexed() const;
+
+    /**
+     * Returns the palette shared by every frame of an indexed sprite.
+     */
+    const Palette& getPalette() const;
+
+    /**
+     * Converts every frame to palette indices, building the palette from the colors the sprite uses with
+     * transparent as index 0. Nothing changes if the sprite uses more than Palette::MAX_COLORS colors, or
+     * if any frame has layers.
+     * @param error - receives why the sprite could not be indexed
+     * @return true if the sprite is now indexed
+     */
+    bool convertToIndexed(QString& error);
+
+    /**
+     * Converts every frame back to ARGB32 colors.
+     */
+    void convertToRgb();
+
+    /**
+     * Changes one color of an indexed sprite's palette, recoloring every pixel using it in every frame. Only
+     * the frames' palettes change, never their tiles.
+     * @param index - the palette index, which must be inside the palette
+     * @param color - the new ARGB32 color
+     */
+    void setPaletteColor(int index, QRgb color);
+
+    /**
+     * Serializes the sprite into the binary .ssp v2 format: a header holding the format version, flags,
+     * width, height and frame count, followed by one raw ARGB32 chunk per frame. Indexed sprites instead
+     * write their palette after the header and one byte per pixel in each chunk. If any frame has layers,
+     * every chunk instead holds a layer count, each layer's visibility, opacity and blend mode, then each
+     * layer's pixels. Each chunk starts with a byte telling if it is a keyframe holding the whole frame or a
+     * delta holding, for each layer, the count and indices of the tiles which changed since the frame before
+     * followed by their pixels. Frames which have not changed since they were opened are copied from the
+     * source without being decoded.
+     * @param device - an open, writable device to serialize to
+     * @param compress - if each frame chunk should be zlib compressed (default = true)
+     * @return true if the whole sprite was written
+     */
+    bool Serialize(QIODevice& device, bool compress = true);
+
+    /**
+     * Deserializes a .ssp project into a new sprite object. Files which do not start with the v2 header
+     * are imported through the legacy JSON format.
+     * @param device - an open, readable device containing the project
+     * @param progress - optionally called after each frame is decoded
+     * @return Sprite* deserialized sprite, or nullptr if the data is not a valid project
+     */
+    static Sprite* Deserialize(QIODevice& device, const ProgressCallback& progress = nullptr);
+
+private:
+    static constexpr quint32 FILE_MAGIC = 0x53535032; // "SSP2"
+    static constexpr quint16 FILE_VERSION = 2;
+    static constexpr quint16 FLAG_COMPRESSED = 0x1;
+    static constexpr quint16 FLAG_INDEXED = 0x2;
+    static constexpr quint16 FLAG_LAYERS = 0x4;
+    static constexpr quint16 FLAG_DELTA = 0x8;
+    static constexpr quint8 CHUNK_KEYFRAME = 0; // With FLAG_DELTA, the byte starting a chunk holding a whole frame
+    static constexpr quint8 CHUNK_DELTA = 1;    // and the byte starting a chunk holding the tiles which changed
+    static const int KEYFRAME_INTERVAL = 16;    // The most chunks decoding one frame of a saved project needs
+
+    /**
+     * The fixed part of a .ssp v2 file, which comes after the magic number.
+     */
+    struct Header {
+        quint16 flags = 0;
+        int width = 0;
+        int height = 0;
+        int frameCount = 0;
+        Palette palette;
+    };
+
+    /**
+     * Reads and validates the header of a binary .ssp v2 project, the magic number having already been read.
+     * @return true if the header is valid
+     */
+    static bool readHeader(QDataStream& stream, Header& header);
+
+    /**
+     * Decodes one frame chunk of a binary .ssp v2 project.
+     * @param data - the chunk
+     * @param size - the size of the chunk in bytes
+     * @param header - the project's header
+     * @param frame - receives the frame, flattened if it has layers. For a delta chunk it must hold the frame
+     * decoded from the chunk before, which is changed into this one
+     * @param layers - receives the frame's layers, or an empty stack if it is a single plain layer. For a
+     * delta chunk it must hold the layers decoded from the chunk before
+     * @return true if the chunk held a whole frame, or a delta of the frame given
+     */
+    static bool decodeChunk(const char* data, qsizetype size, const Header& header, Frame& frame, LayerStack& layers);
+
+    /**
+     * Writes the tiles held by the uncompressed body of a delta chunk into the frame before it.
+     * @param chunk - the body of the chunk
+     * @param header - the project's header
+     * @param frame - the frame decoded from the chunk before, changed into this one
+     * @param layers - the layers decoded from the chunk before, changed into this one's
+     * @return true if the chunk was a valid delta of the frame
+     */
+    static bool decodeDelta(const QByteArray& chunk, const Header& header, Frame& frame, LayerStack& layers);
+
+    /**
+     * Decodes a chunk of the source, first decoding the chunks before it back to the keyframe it continues
+     * from. The source is only read, so any thread may decode from it.
+     * @param source - the memory mapped project
+     * @param header - the project's header
+     * @param chunk - the index of the chunk
+     * @param frame - receives the frame, flattened if it has layers
+     * @param layers - receives the frame's layers, or an empty stack if it is a single plain layer
+     * @return true if every chunk needed was valid
+     */
+    static bool decodeSourceChunk(const FrameSource& source, const Header& header, int chunk, Frame& frame, LayerStack& layers);
+
+    /**
+     * Returns the header frames of the source are decoded with.
+     */
+    Header sourceHeader() const;
+
+    /**
+     * Deserializes the body of a binary .ssp v2 project, the magic number having already been read.
+     * @param stream - the stream positioned just after the magic number
+     * @param progress - optionally called after each frame is decoded
+     * @return Sprite* deserialized sprite, or nullptr if the data is invalid
      */
-    QString Serialize();
+    static Sprite* DeserializeBinary(QDataStream& stream, const ProgressCallback& progress);
 
     /**
-     * Deserializes the given data into a new sprite object
-     * @param jsonData - A QByteArray containing the JSON data of the sprite
-     * @return Sprite* deserialized sprite
+     * Imports a legacy JSON project one frame at a time, validating it as it goes.
+     * @param device - the device positioned at the start of the project
+     * @param progress - optionally called after each frame is decoded
+     * @return Sprite* deserialized sprite, or nullptr if the data is invalid
      */
-    Sprite* Deserialize(const QByteArray& jsonData);
+    static Sprite* DeserializeJson(QIODevice& device, const ProgressCallback& progress);
 };
 
 #endif // SPRITE_H
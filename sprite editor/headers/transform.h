@@ -0,0 +1,74 @@
+/**
+ * Whole-frame transforms, such as flips, rotations and shifts, applied to many frames of an animation at
+ * once. Each transform has an exact inverse, so undoing one only needs the transform rather than the pixels
+ * it replaced. The kernels work a strip of tile rows at a time, so every tile of the source and destination
+ * is read and written once whatever the transform.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "frame.h"
+
+enum class TransformType {FLIP_HORIZONTAL, FLIP_VERTICAL, ROTATE_CLOCKWISE, ROTATE_COUNTERCLOCKWISE, ROTATE_HALF,
+                          SHIFT, INVERT_COLORS};
+
+class FrameTransform
+{
+public:
+    /**
+     * Constructs a transform.
+     * @param type - what the transform does
+     * @param dx - for SHIFT, how far right pixels move, wrapping around the frame
+     * @param dy - for SHIFT, how far down pixels move, wrapping around the frame
+     */
+    FrameTransform(TransformType type = TransformType::FLIP_HORIZONTAL, int dx = 0, int dy = 0);
+
+    TransformType getType() const;
+    int getDx() const;
+    int getDy() const;
+
+    /**
+     * Returns the transform which undoes this one.
+     */
+    FrameTransform inverse() const;
+
+    /**
+     * Returns if the transform turns a frame a quarter turn, swapping its width and height.
+     */
+    bool swapsSize() const;
+
+    /**
+     * Returns if the transform only changes colors, which for indexed frames is done to their palette.
+     */
+    bool isRecolor() const;
+
+    /**
+     * Returns a transformed copy of a frame. Indexed frames are moved by their indices, so they stay indexed
+     * with the same palette. INVERT_COLORS leaves an indexed frame unchanged, as it only changes the palette.
+     * @param frame - the frame to transform, which is only read so other threads may read it as well
+     */
+    Frame apply(const Frame& frame) const;
+
+    /**
+     * Returns an inverted color, keeping its alpha.
+     */
+    static QRgb invert(QRgb color);
+
+private:
+    TransformType type;
+    int dx;
+    int dy;
+
+    /**
+     * Transforms the pixels of an ARGB32 frame, or the indices of an indexed one, into a destination of the
+     * transformed size.
+     */
+    template <typename T>
+    void transformPixels(const Frame& source, Frame& destination) const;
+};
+
+#endif // TRANSFORM_H
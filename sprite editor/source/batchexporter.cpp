@@ -0,0 +1,170 @@
+/**
+ * Converts .ssp projects to PNG files without a GUI, for use from the command line. Each project becomes
+ * a numbered PNG per frame, a single sprite sheet, or both, and projects are converted in parallel.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "batchexporter.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtMath>
+#include <limits>
+#include <memory>
+
+BatchExporter::BatchExporter(const Options& options) : options{options} {}
+
+QVector<BatchExporter::Project> BatchExporter::findProjects(const QStringList& paths, QStringList& errors) const{
+    QVector<Project> candidates;
+    for (const QString& path : paths) {
+        const QFileInfo info(path);
+        if (info.isFile()) {
+            candidates.append({info.absoluteFilePath(), options.outputDir.isEmpty() ? info.absolutePath() : options.outputDir});
+            continue;
+        }
+        if (!info.isDir()) {
+            errors.append(path + ": no such file or directory");
+            continue;
+        }
+
+        // Sort each directory's projects so the output order does not depend on the file system
+        const QDir root(info.absoluteFilePath());
+        QStringList found;
+        QDirIterator it(root.path(), {"*.ssp"}, QDir::Files,
+                        options.recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext())
+            found.append(it.next());
+        found.sort();
+
+        for (const QString& file : std::as_const(found)) {
+            const QFileInfo fileInfo(file);
+            QString outputDir = fileInfo.absolutePath();
+            // Keep the directory's own name under the output directory, so directories holding projects of
+            // the same name do not write over each other
+            if (!options.outputDir.isEmpty())
+                outputDir = QDir::cleanPath(options.outputDir + "/" + root.dirName() + "/" + root.relativeFilePath(fileInfo.absolutePath()));
+            candidates.append({fileInfo.absoluteFilePath(), outputDir});
+        }
+    }
+
+    // Projects are exported in parallel, so a project given twice, or two projects writing the same PNGs,
+    // would have workers overwriting each other's files. The first keeps its place and the rest are reported.
+    QVector<Project> projects;
+    QSet<QString> inputs;
+    QHash<QString, QString> outputs;
+    for (const Project& project : std::as_const(candidates)) {
+        const QString input = QFileInfo(project.path).canonicalFilePath();
+        if (inputs.contains(input))
+            continue;
+        inputs.insert(input);
+
+        const QString output = QDir::cleanPath(project.outputDir + "/" + QFileInfo(project.path).completeBaseName());
+        if (outputs.contains(output)) {
+            errors.append(project.path + ": would overwrite the PNGs of " + outputs.value(output) + ", skipped");
+            continue;
+        }
+        outputs.insert(output, project.path);
+        projects.append(project);
+    }
+    return projects;
+}
+
+int BatchExporter::run(const QVector<Project>& projects, const ResultCallback& onResult) const{
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.jobs > 0 ? options.jobs : QThread::idealThreadCount());
+
+    // Each project is decoded, converted and written by one worker, so projects never share any state
+    QAtomicInt failures = 0;
+    for (const Project& project : projects) {
+        pool.start([this, &project, &failures, &onResult]() {
+            QString error;
+            const int frames = exportProject(project, error);
+            if (frames < 0)
+                failures.fetchAndAddRelaxed(1);
+            if (onResult)
+                onResult(project, qMax(0, frames), error);
+        });
+    }
+    pool.waitForDone();
+    return failures.loadRelaxed();
+}
+
+int BatchExporter::exportProject(const Project& project, QString& error) const{
+    // Frames are decoded as they are exported, so memory stays bounded however long the animation is
+    const std::unique_ptr<Sprite> sprite(Sprite::Open(project.path));
+    if (!sprite) {
+        error = "not a valid sprite project";
+        return -1;
+    }
+    if (!QDir().mkpath(project.outputDir)) {
+        error = "could not create " + project.outputDir;
+        return -1;
+    }
+
+    const QString baseName = QDir(project.outputDir).filePath(QFileInfo(project.path).completeBaseName());
+    const int frameCount = sprite->getFrameCount();
+
+    if (options.sequence) {
+        // Number the frames from 1 like the editor does, padded so the files sort in order
+        const int digits = qMax(3, int(QString::number(frameCount).size()));
+        for (int i = 0; i < frameCount; i++) {
+            const QString path = baseName + "_" + QString::number(i + 1).rightJustified(digits, '0') + ".png";
+            if (!sprite->getFrame(i, false).toImage().save(path, "PNG")) {
+                error = "could not write " + path;
+                return -1;
+            }
+        }
+    }
+
+    if (options.sheet) {
+        const QImage sheet = buildSheet(*sprite, options.sheetColumns);
+        if (sheet.isNull()) {
+            error = "sprite sheet would be too large";
+            return -1;
+        }
+        const QString path = baseName + "_sheet.png";
+        if (!sheet.save(path, "PNG")) {
+            error = "could not write " + path;
+            return -1;
+        }
+    }
+
+    return frameCount;
+}
+
+QImage BatchExporter::buildSheet(Sprite& sprite, int columns){
+    const int frameCount = sprite.getFrameCount();
+    const int width = sprite.getWidth();
+    const int height = sprite.getHeight();
+    if (columns <= 0)
+        columns = qCeil(qSqrt(frameCount));
+    columns = qMax(1, qMin(columns, frameCount));
+    const int rows = (frameCount + columns - 1) / columns;
+
+    // QImage cannot address more than 2 GiB, so refuse sheets it could not allocate
+    const qint64 sheetWidth = qint64(width) * columns;
+    const qint64 sheetHeight = qint64(height) * rows;
+    if (sheetWidth * sheetHeight * qint64(sizeof(QRgb)) > std::numeric_limits<int>::max())
+        return QImage();
+
+    QImage sheet(int(sheetWidth), int(sheetHeight), QImage::Format_ARGB32);
+    if (sheet.isNull())
+        return sheet;
+    sheet.fill(Qt::transparent);
+
+    for (int i = 0; i < frameCount; i++) {
+        const Frame& frame = sprite.getFrame(i, false);
+        const int left = (i % columns) * width;
+        const int top = (i / columns) * height;
+        for (int y = 0; y < height; y++)
+            frame.readRow(0, y, width, reinterpret_cast<QRgb*>(sheet.scanLine(top + y)) + left);
+    }
+    return sheet;
+}
@@ -0,0 +1,215 @@
+/**
+ * Times the core sprite operations over a range of canvas sizes and frame counts, writing the results as
+ * JSON and comparing them against a stored baseline so performance regressions can be caught by a script.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "benchmark.h"
+#include "brush.h"
+#include "floodfill.h"
+#include "history.h"
+#include "sprite.h"
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTextStream>
+#include <memory>
+
+namespace {
+// Colors alternate between iterations so every repetition really rewrites the pixels
+const QRgb COLORS[] = {qRgba(255, 0, 0, 255), qRgba(0, 0, 255, 255)};
+
+/**
+ * Makes a sprite whose frames hold a background and a square which moves from frame to frame, so the
+ * frames compress and share tiles like a real animation does.
+ */
+std::unique_ptr<Sprite> makeSprite(QSize size, int frames){
+    std::unique_ptr<Sprite> sprite(new Sprite(size.width(), size.height()));
+    for (int i = 1; i < frames; i++)
+        sprite->addFrame();
+    for (int i = 0; i < frames; i++) {
+        sprite->getFrame(i, true);
+        sprite->fillRect(QRect(QPoint(0, 0), size), qRgba(40, 60, 80, 255));
+        const QRect square((i * 7) % size.width(), (i * 5) % size.height(), size.width() / 4 + 1, size.height() / 4 + 1);
+        sprite->fillRect(square, qRgba(200, 180, 20, 255));
+    }
+    sprite->getFrame(0, true);
+    return sprite;
+}
+}
+
+QString Benchmark::Result::key() const{
+    return QString("%1/%2x%3/%4").arg(name).arg(size.width()).arg(size.height()).arg(frames);
+}
+
+Benchmark::Benchmark(const QVector<QSize>& sizes, const QVector<int>& frameCounts, qint64 minTimeMs)
+    : sizes{sizes}, frameCounts{frameCounts}, minTimeMs{minTimeMs} {}
+
+Benchmark::Result Benchmark::measure(const std::function<void(qint64 iteration)>& operation) const{
+    QElapsedTimer timer;
+    for (qint64 iterations = 1; ; iterations *= 2) {
+        timer.start();
+        for (qint64 i = 0; i < iterations; i++)
+            operation(i);
+        const qint64 elapsed = timer.nsecsElapsed();
+        if (elapsed >= minTimeMs * 1000000)
+            return Result{{}, {}, 0, iterations, double(elapsed) / iterations};
+    }
+}
+
+QVector<Benchmark::Result> Benchmark::run(QTextStream& log) const{
+    QVector<Result> results;
+    const auto record = [&](const QString& name, QSize size, int frames, Result result) {
+        result.name = name;
+        result.size = size;
+        result.frames = frames;
+        results.append(result);
+        log << result.key().leftJustified(48) << QString::number(result.nsPerIteration, 'f', 0).rightJustified(14)
+            << " ns  (" << result.iterations << " iterations)\n" << Qt::flush;
+    };
+
+    for (const QSize& size : sizes) {
+        // Single frame operations, as done by the editor's tools
+        std::unique_ptr<Sprite> sprite = makeSprite(size, 1);
+        record("Sprite::setPixel", size, 1, measure([&](qint64 iteration) {
+            const QRgb color = COLORS[iteration & 1];
+            for (int y = 0; y < size.height(); y++)
+                for (int x = 0; x < size.width(); x++)
+                    sprite->setPixel(QPoint(x, y), color);
+        }));
+
+        // Model::fillImage is a flood fill of the current frame, here over the whole canvas
+        record("FloodFill::fill", size, 1, measure([&](qint64 iteration) {
+            FloodFill::fill(sprite->getFrame(), QPoint(0, 0), COLORS[iteration & 1]);
+        }));
+
+        // Blending a translucent color over the whole canvas, as a translucent fill does
+        record("Frame::blendRect", size, 1, measure([&](qint64 iteration) {
+            sprite->getFrame().blendRect(sprite->getFrame().getRect(), COLORS[iteration & 1] & 0x80ffffff, BlendMode::SOURCE_OVER);
+        }));
+
+        // Dragging a large round brush corner to corner, as the pen does
+        const Brush brush(BrushShape::ROUND, 32);
+        const QVector<QPoint> diagonal = [&]() {
+            QVector<QPoint> centers;
+            for (int i = 0; i < qMin(size.width(), size.height()); i++)
+                centers.append(QPoint(i, i));
+            return centers;
+        }();
+        record("Brush::stroke", size, 1, measure([&](qint64 iteration) {
+            brush.stroke(sprite->getFrame(), sprite->getFrame(), diagonal, COLORS[iteration & 1], BlendMode::REPLACE);
+        }));
+
+        // The same stroke on the middle of eight layers, flattened as the editor does after every batch
+        std::unique_ptr<Sprite> layered = makeSprite(size, 1);
+        for (int layer = 1; layer < 8; layer++)
+            layered->addLayer(0, layer);
+        record("Sprite::layerEdited", size, 1, measure([&](qint64 iteration) {
+            const QRect dirtyRect = brush.stroke(layered->getLayerPixels(0, 4), layered->getLayerPixels(0, 4), diagonal, COLORS[iteration & 1], BlendMode::REPLACE);
+            layered->layerEdited(0, 4, dirtyRect);
+        }));
+
+        // Recording a stroke into the history once it is finished
+        const Frame before = makeSprite(size, 1)->getFrame();
+        Frame after = before;
+        after.fillRect(QRect(0, 0, size.width() / 2, size.height() / 2), COLORS[0]);
+        History history;
+        record("History::recordPixels", size, 1, measure([&](qint64) {
+            history.recordPixels(0, 0, before, after, after.getRect());
+        }));
+
+        // Scaling a frame down for the animation preview
+        const QSize previewSize = size.scaled(Sprite::PREVIEW_SIZE, Sprite::PREVIEW_SIZE, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+        record("Frame::toImage(preview)", size, 1, measure([&](qint64) {
+            sprite->getFrame().toImage(previewSize);
+        }));
+
+        // Whole project operations, as done when saving and loading
+        for (int frames : frameCounts) {
+            std::unique_ptr<Sprite> project = makeSprite(size, frames);
+            QByteArray bytes;
+            record("Sprite::Serialize", size, frames, measure([&](qint64) {
+                bytes.clear();
+                QBuffer buffer(&bytes);
+                buffer.open(QIODevice::WriteOnly);
+                project->Serialize(buffer);
+            }));
+            record("Sprite::Deserialize", size, frames, measure([&](qint64) {
+                QBuffer buffer(&bytes);
+                buffer.open(QIODevice::ReadOnly);
+                delete Sprite::Deserialize(buffer);
+            }));
+
+            // Flipping the whole animation, one frame per worker thread
+            record("Sprite::transformFrames", size, frames, measure([&](qint64) {
+                project->transformFrames(0, frames - 1, FrameTransform(TransformType::FLIP_HORIZONTAL));
+            }));
+
+            // Recoloring the background of the whole animation and back, with a tolerance
+            const QRgb backgrounds[] = {qRgba(40, 60, 80, 255), qRgba(80, 60, 40, 255)};
+            record("Sprite::replaceColor", size, frames, measure([&](qint64 iteration) {
+                project->replaceColor(0, frames - 1, backgrounds[iteration & 1], backgrounds[(iteration + 1) & 1], 8);
+            }));
+        }
+    }
+    return results;
+}
+
+QJsonDocument Benchmark::toJson(const QVector<Result>& results){
+    QJsonArray array;
+    for (const Result& result : results) {
+        array.append(QJsonObject{
+            {"name", result.name},
+            {"width", result.size.width()},
+            {"height", result.size.height()},
+            {"frames", result.frames},
+            {"iterations", result.iterations},
+            {"nsPerIteration", result.nsPerIteration},
+        });
+    }
+    return QJsonDocument(QJsonObject{{"version", 1}, {"results", array}});
+}
+
+QVector<Benchmark::Result> Benchmark::fromJson(const QJsonDocument& document){
+    QVector<Result> results;
+    const QJsonArray array = document.object().value("results").toArray();
+    for (const QJsonValue& value : array) {
+        const QJsonObject object = value.toObject();
+        results.append(Result{
+            object.value("name").toString(),
+            QSize(object.value("width").toInt(), object.value("height").toInt()),
+            object.value("frames").toInt(),
+            qint64(object.value("iterations").toDouble()),
+            object.value("nsPerIteration").toDouble(),
+        });
+    }
+    return results;
+}
+
+int Benchmark::compare(const QVector<Result>& results, const QVector<Result>& baseline, double threshold, QTextStream& log){
+    QHash<QString, double> baselineTimes;
+    for (const Result& result : baseline)
+        baselineTimes.insert(result.key(), result.nsPerIteration);
+
+    int regressions = 0;
+    for (const Result& result : results) {
+        log << result.key().leftJustified(48);
+        const double baselineTime = baselineTimes.value(result.key(), 0);
+        if (baselineTime <= 0) {
+            log << "not in baseline\n";
+            continue;
+        }
+        const double change = (result.nsPerIteration / baselineTime - 1) * 100;
+        log << (change >= 0 ? "+" : "") << QString::number(change, 'f', 1) << "%";
+        if (change > threshold) {
+            log << "  REGRESSION";
+            regressions++;
+        }
+        log << "\n";
+    }
+    return regressions;
+}
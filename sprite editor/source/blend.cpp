@@ -0,0 +1,94 @@
+/**
+ * Blending kernels used by the pen and fill tools to composite a color onto pixels. Frames store straight
+ * (not premultiplied) ARGB32, so each pixel of a span is premultiplied, blended and unpremultiplied in one
+ * pass. The premultiplying and blending work on two channels per 32-bit operation, like Qt's own draw
+ * helpers.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "blend.h"
+#include <algorithm>
+#include <cstring>
+
+QRgb Blend::blend(QRgb under, QRgb color, BlendMode mode){
+    QRgb result;
+    blendSpan(&result, &under, 1, color, mode);
+    return result;
+}
+
+bool Blend::isNoOp(QRgb color, BlendMode mode){
+    return mode != BlendMode::REPLACE && qAlpha(color) == 0;
+}
+
+void Blend::blendSpan(QRgb* out, const QRgb* under, int count, QRgb color, BlendMode mode){
+    if (isNoOp(color, mode)) {
+        if (out != under)
+            std::memcpy(out, under, count * sizeof(QRgb));
+        return;
+    }
+
+    switch (mode) {
+    case BlendMode::SOURCE_OVER:
+        // An opaque color covers whatever is under it
+        if (qAlpha(color) == 255)
+            std::fill_n(out, count, color);
+        else
+            sourceOver(out, under, count, color);
+        break;
+    case BlendMode::MULTIPLY:
+        multiply(out, under, count, color);
+        break;
+    case BlendMode::ADD:
+        add(out, under, count, color);
+        break;
+    case BlendMode::REPLACE:
+        std::fill_n(out, count, color);
+        break;
+    }
+}
+
+void Blend::blendLayer(QRgb* destination, const QRgb* pixels, int count, uint opacity, BlendMode mode){
+    if (opacity == 0)
+        return;
+
+    // The mode is the same across the span, so each mode gets its own loop
+    switch (mode) {
+    case BlendMode::SOURCE_OVER:
+        for (int i = 0; i < count; i++)
+            destination[i] = over(byteMul(qPremultiply(pixels[i]), opacity), destination[i]);
+        break;
+    case BlendMode::MULTIPLY:
+        for (int i = 0; i < count; i++)
+            destination[i] = multiplyPixel(byteMul(qPremultiply(pixels[i]), opacity), destination[i]);
+        break;
+    case BlendMode::ADD:
+        for (int i = 0; i < count; i++)
+            destination[i] = addPixel(byteMul(qPremultiply(pixels[i]), opacity), destination[i]);
+        break;
+    case BlendMode::REPLACE:
+        for (int i = 0; i < count; i++)
+            destination[i] = byteMul(qPremultiply(pixels[i]), opacity);
+        break;
+    }
+}
+
+void Blend::sourceOver(QRgb* out, const QRgb* under, int count, QRgb color){
+    const QRgb source = qPremultiply(color);
+    const uint inverseAlpha = 255 - qAlpha(source);
+    for (int i = 0; i < count; i++)
+        out[i] = qUnpremultiply(source + byteMul(qPremultiply(under[i]), inverseAlpha));
+}
+
+void Blend::multiply(QRgb* out, const QRgb* under, int count, QRgb color){
+    const QRgb source = qPremultiply(color);
+    for (int i = 0; i < count; i++)
+        out[i] = qUnpremultiply(multiplyPixel(source, qPremultiply(under[i])));
+}
+
+void Blend::add(QRgb* out, const QRgb* under, int count, QRgb color){
+    const QRgb source = qPremultiply(color);
+    for (int i = 0; i < count; i++)
+        out[i] = qUnpremultiply(addPixel(source, qPremultiply(under[i])));
+}
@@ -0,0 +1,100 @@
+/**
+ * The footprint of the pen and eraser. A brush's mask is stored as one span per row and cached for each
+ * shape and size, and a stroke is drawn a straight segment at a time: the stamps along a segment cover one
+ * span per row between them, so each pixel of the segment is written once however large the brush is.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "brush.h"
+#include <QHash>
+#include <QtMath>
+#include <limits>
+
+Brush::Brush(BrushShape shape, int size) : shape{shape}, size{qBound(1, size, MAX_SIZE)} {
+    static QHash<int, QVector<Span>> masks;
+    const int key = int(shape) * (MAX_SIZE + 1) + this->size;
+    if (!masks.contains(key))
+        masks.insert(key, makeMask(shape, this->size));
+    spans = masks.value(key);
+}
+
+BrushShape Brush::getShape() const{
+    return shape;
+}
+
+int Brush::getSize() const{
+    return size;
+}
+
+QVector<Brush::Span> Brush::makeMask(BrushShape shape, int size){
+    QVector<Span> mask(size);
+    const double radius = size / 2.0;
+    for (int row = 0; row < size; row++) {
+        if (shape == BrushShape::SQUARE) {
+            mask[row] = Span{0, size};
+            continue;
+        }
+
+        // Cover the pixels whose centers lie inside the circle
+        const double y = row + 0.5 - radius;
+        const double halfWidth = qSqrt(qMax(0.0, radius * radius - y * y));
+        const int left = qMax(0, int(qCeil(radius - halfWidth - 0.5)));
+        const int right = qMin(size - 1, int(qFloor(radius + halfWidth - 0.5)));
+        mask[row] = Span{left, qMax(1, right - left + 1)};
+    }
+    return mask;
+}
+
+QRect Brush::stroke(Frame& frame, const Frame& under, const QVector<QPoint>& centers, QRgb color, BlendMode mode) const{
+    if (centers.isEmpty())
+        return QRect();
+
+    // The brush's top left corner is offset from its center, for even sizes towards the top left
+    const int offset = size / 2;
+    int top = std::numeric_limits<int>::max();
+    int bottom = std::numeric_limits<int>::min();
+    for (const QPoint& center : centers) {
+        top = qMin(top, center.y() - offset);
+        bottom = qMax(bottom, center.y() - offset + size - 1);
+    }
+    top = qMax(top, 0);
+    bottom = qMin(bottom, frame.getHeight() - 1);
+    if (top > bottom)
+        return QRect();
+
+    // Along a straight segment the stamps covering a row overlap, so together they cover one span of it
+    QVector<int> lefts(bottom - top + 1, std::numeric_limits<int>::max());
+    QVector<int> rights(bottom - top + 1, std::numeric_limits<int>::min());
+    for (const QPoint& center : centers) {
+        const int first = qMax(top, center.y() - offset);
+        const int last = qMin(bottom, center.y() - offset + size - 1);
+        for (int y = first; y <= last; y++) {
+            const Span& span = spans.at(y - (center.y() - offset));
+            const int left = center.x() - offset + span.left;
+            lefts[y - top] = qMin(lefts[y - top], left);
+            rights[y - top] = qMax(rights[y - top], left + span.length - 1);
+        }
+    }
+
+    QRect dirtyRect;
+    QVector<QRgb> row;
+    for (int y = top; y <= bottom; y++) {
+        const int left = qMax(lefts[y - top], 0);
+        const int right = qMin(rights[y - top], frame.getWidth() - 1);
+        if (left > right)
+            continue;
+        const int count = right - left + 1;
+        if (mode == BlendMode::REPLACE) {
+            frame.fillRect(QRect(left, y, count, 1), color);
+        } else {
+            row.resize(count);
+            under.readRow(left, y, count, row.data());
+            Blend::blendSpan(row.data(), row.constData(), count, color, mode);
+            frame.writeRow(left, y, count, row.constData());
+        }
+        dirtyRect |= QRect(left, y, count, 1);
+    }
+    return dirtyRect;
+}
@@ -1,6 +1,7 @@
 /**
  * Represent the Canvas area of sprite editor. It is an interactive drawing surface where mouse actions can
- * be recorded to trigger drawing actions.
+ * be recorded to trigger drawing actions. Large sprites can be zoomed with the mouse wheel and panned by
+ * dragging with the middle mouse button, and only the part of the sprite in view is ever drawn.
  *
  * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
  * March 31, 2025
@@ -9,23 +10,299 @@
  **/
 
 #include "canvaslabel.h"
+#include "blend.h"
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QPainter>
+#include <QtMath>
+#include <algorithm>
+
+/**
+ * Composites a premultiplied pixel over an opaque checkerboard color.
+ */
+static inline QRgb overChecker(QRgb pixel, QRgb checker){
+    const int inverse = 255 - qAlpha(pixel);
+    if (inverse == 0)
+        return pixel;
+    return qRgb(qRed(pixel) + qRed(checker) * inverse / 255,
+                qGreen(pixel) + qGreen(checker) * inverse / 255,
+                qBlue(pixel) + qBlue(checker) * inverse / 255);
+}
 
 CanvasLabel::CanvasLabel(QWidget *parent) : QLabel(parent) {
     setMouseTracking(true);
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FLUSH_INTERVAL);
+    flushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&flushTimer, &QTimer::timeout, this, &CanvasLabel::flushPositions);
+
+    overlayFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    overlayTimer.setInterval(OVERLAY_INTERVAL);
+    connect(&overlayTimer, &QTimer::timeout, this, [this]() { update(overlayRect); });
 }
 
 void CanvasLabel::mouseMoveEvent(QMouseEvent *event){
-    QPoint mousePos = event->pos();
-    if(isDrawing)
-        emit draw(mousePos);
+    if (isPanning) {
+        setViewport(zoom, offset + event->pos() - lastPanPos);
+        lastPanPos = event->pos();
+        emit viewportChanged();
+        return;
+    }
+    if(!isDrawing)
+        return;
+
+    // Batch positions until the next display frame instead of drawing on every event
+    if (latency != nullptr && pendingPositions.isEmpty())
+        batchStart = latency->now();
+    pendingPositions.append(event->pos());
+    if (!flushTimer.isActive())
+        flushTimer.start();
 }
 
 void CanvasLabel::mousePressEvent(QMouseEvent *event){
-    QPoint mousePos = event->pos();
-    emit draw(mousePos);
+    if (event->button() == Qt::MiddleButton) {
+        isPanning = true;
+        lastPanPos = event->pos();
+        return;
+    }
+    flushPositions();
+    if (latency != nullptr)
+        drawingInput = latency->now();
+    emit draw({event->pos()}, true);
+    drawingInput = -1;
     isDrawing = true;
 }
 
 void CanvasLabel::mouseReleaseEvent(QMouseEvent *event){
+    if (event->button() == Qt::MiddleButton) {
+        isPanning = false;
+        return;
+    }
+    if (!isDrawing)
+        return;
+    flushPositions();
     isDrawing = false;
+    emit strokeFinished();
+}
+
+void CanvasLabel::flushPositions(){
+    flushTimer.stop();
+    if (pendingPositions.isEmpty())
+        return;
+
+    QVector<QPoint> positions;
+    positions.swap(pendingPositions);
+    if (latency != nullptr && batchStart >= 0) {
+        latency->recordSince(LatencyMonitor::INPUT, batchStart);
+        drawingInput = batchStart;
+        batchStart = -1;
+    }
+    emit draw(positions, false);
+    drawingInput = -1;
+}
+
+void CanvasLabel::drawFrame(const Frame& frame, QRect dirtyRect){
+    if (frame.getRect().size() != imageSize || backing.size() != size()) {
+        setSpriteSize(frame.getRect().size());
+        dirtyRect = frame.getRect();
+    }
+    dirtyRect &= visibleRect();
+    if (dirtyRect.isEmpty())
+        return;
+
+    const QRect target = QRect(QPoint(cellLeft(dirtyRect.left()), cellTop(dirtyRect.top())),
+                               QPoint(cellLeft(dirtyRect.right() + 1) - 1, cellTop(dirtyRect.bottom() + 1) - 1)) & backing.rect();
+    if (target.isEmpty())
+        return;
+
+    columnSource.resize(target.width());
+    for (int x = 0; x < target.width(); x++)
+        columnSource[x] = qBound(dirtyRect.left(), pixelColumn(target.left() + x), dirtyRect.right());
+
+    // Zoomed out, each canvas pixel samples a single sprite pixel rather than reading whole rows
+    const bool zoomedOut = zoom < 1;
+    const bool showOnionSkin = onionSkin.getRect() == frame.getRect();
+    rowBuffer.resize(dirtyRect.width());
+    onionBuffer.resize(dirtyRect.width());
+    const QRgb* source = rowBuffer.constData() - dirtyRect.left();
+    const QRgb* previousLine = nullptr;
+    int previousRow = -1;
+    for (int y = target.top(); y <= target.bottom(); y++) {
+        QRgb* line = reinterpret_cast<QRgb*>(backing.scanLine(y)) + target.left();
+        const int row = qBound(dirtyRect.top(), pixelRow(y), dirtyRect.bottom());
+
+        // Zoomed in, a sprite row covers several canvas rows, so paint it once and copy it down
+        if (row == previousRow) {
+            std::copy(previousLine, previousLine + target.width(), line);
+            continue;
+        }
+
+        if (zoomedOut) {
+            const int checkerY = (y - offset.y()) / CHECKER_SIZE;
+            for (int x = 0; x < target.width(); x++) {
+                const bool dark = ((target.left() + x - offset.x()) / CHECKER_SIZE + checkerY) & 1;
+                QRgb pixel = qPremultiply(frame.getPixel(columnSource[x], row));
+                if (showOnionSkin)
+                    pixel = Blend::over(pixel, onionSkin.getPixel(columnSource[x], row));
+                line[x] = overChecker(pixel, dark ? CHECKER_DARK : CHECKER_LIGHT);
+            }
+        } else {
+            frame.readRow(dirtyRect.left(), row, dirtyRect.width(), rowBuffer.data());
+            if (showOnionSkin) {
+                onionSkin.readRow(dirtyRect.left(), row, dirtyRect.width(), onionBuffer.data());
+                for (int x = 0; x < dirtyRect.width(); x++)
+                    rowBuffer[x] = Blend::over(qPremultiply(rowBuffer[x]), onionBuffer[x]);
+            } else {
+                for (int x = 0; x < dirtyRect.width(); x++)
+                    rowBuffer[x] = qPremultiply(rowBuffer[x]);
+            }
+            for (int x = 0; x < target.width(); x++) {
+                const int column = columnSource[x];
+                line[x] = overChecker(source[column], (column + row) & 1 ? CHECKER_DARK : CHECKER_LIGHT);
+            }
+            previousRow = row;
+            previousLine = line;
+        }
+    }
+
+    update(target);
+    if (latency != nullptr) {
+        if (presentStart < 0)
+            presentStart = latency->now();
+        if (presentInput < 0)
+            presentInput = drawingInput;
+    }
+}
+
+void CanvasLabel::setOnionSkin(const Frame& composite){
+    onionSkin = composite;
+}
+
+void CanvasLabel::setSpriteSize(QSize spriteSize){
+    imageSize = spriteSize;
+    setViewport(fitZoom(), QPoint());
+}
+
+QPoint CanvasLabel::pixelAt(QPoint pos) const{
+    return QPoint(pixelColumn(pos.x()), pixelRow(pos.y()));
+}
+
+int CanvasLabel::cellLeft(int x) const{
+    return offset.x() + qFloor(x * zoom);
+}
+
+int CanvasLabel::cellTop(int y) const{
+    return offset.y() + qFloor(y * zoom);
+}
+
+int CanvasLabel::pixelColumn(int x) const{
+    // The last sprite column whose cell starts at or before the canvas column
+    return qCeil((x - offset.x() + 1) / zoom) - 1;
+}
+
+int CanvasLabel::pixelRow(int y) const{
+    return qCeil((y - offset.y() + 1) / zoom) - 1;
+}
+
+QRect CanvasLabel::visibleRect() const{
+    const QRect view(pixelAt(QPoint(0, 0)), pixelAt(QPoint(width() - 1, height() - 1)));
+    return view & QRect(QPoint(0, 0), imageSize);
+}
+
+double CanvasLabel::fitZoom() const{
+    if (imageSize.isEmpty())
+        return 1;
+    return qMin(double(width()) / imageSize.width(), double(height()) / imageSize.height());
+}
+
+void CanvasLabel::setViewport(double newZoom, QPoint newOffset){
+    zoom = qBound(fitZoom(), newZoom, qMax(fitZoom(), double(MAX_ZOOM)));
+
+    const int shownWidth = qCeil(imageSize.width() * zoom);
+    const int shownHeight = qCeil(imageSize.height() * zoom);
+    if (shownWidth <= width())
+        newOffset.setX((width() - shownWidth) / 2);
+    else
+        newOffset.setX(qBound(width() - shownWidth, newOffset.x(), 0));
+    if (shownHeight <= height())
+        newOffset.setY((height() - shownHeight) / 2);
+    else
+        newOffset.setY(qBound(height() - shownHeight, newOffset.y(), 0));
+    offset = newOffset;
+
+    backing = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+    backing.fill(Qt::transparent);
+    update();
+}
+
+void CanvasLabel::wheelEvent(QWheelEvent *event){
+    const int steps = event->angleDelta().y() / 120;
+    if (steps == 0 || imageSize.isEmpty())
+        return;
+
+    // Keep the sprite position under the mouse where it is
+    const QPointF mouse = event->position();
+    const QPointF spritePos((mouse.x() - offset.x()) / zoom, (mouse.y() - offset.y()) / zoom);
+    const double newZoom = qBound(fitZoom(), zoom * qPow(2, steps), qMax(fitZoom(), double(MAX_ZOOM)));
+    setViewport(newZoom, QPoint(qRound(mouse.x() - spritePos.x() * newZoom), qRound(mouse.y() - spritePos.y() * newZoom)));
+    emit viewportChanged();
+}
+
+void CanvasLabel::paintEvent(QPaintEvent *event){
+    if (!backing.isNull()) {
+        QPainter painter(this);
+        painter.drawImage(event->rect(), backing, event->rect());
+    }
+
+    // Draws the label's frame on top of the canvas
+    QLabel::paintEvent(event);
+
+    // Record before drawing the overlay, so the overlay's own cost is left out
+    if (latency != nullptr && presentStart >= 0) {
+        latency->recordSince(LatencyMonitor::PRESENT, presentStart);
+        if (presentInput >= 0)
+            latency->recordSince(LatencyMonitor::TOTAL, presentInput);
+        presentStart = -1;
+        presentInput = -1;
+    }
+
+    if (showLatency && latency != nullptr && event->rect().intersects(overlayRect)) {
+        QPainter painter(this);
+        painter.setFont(overlayFont);
+        painter.fillRect(overlayRect, QColor(0, 0, 0, 180));
+        painter.setPen(Qt::white);
+        painter.drawText(overlayRect.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop, latency->report().join('\n'));
+    }
+}
+
+void CanvasLabel::setLatencyMonitor(LatencyMonitor *monitor){
+    latency = monitor;
+}
+
+void CanvasLabel::setLatencyOverlayVisible(bool visible){
+    showLatency = visible;
+    if (!visible) {
+        overlayTimer.stop();
+        update(overlayRect);
+        return;
+    }
+
+    // Size the overlay to fit the report in the font it is drawn with
+    const QFontMetrics metrics(overlayFont);
+    const QStringList lines = latency != nullptr ? latency->report() : QStringList();
+    int textWidth = 0;
+    for (const QString& line : lines)
+        textWidth = qMax(textWidth, metrics.horizontalAdvance(line));
+    overlayRect = QRect(4, 4, textWidth + 8, metrics.lineSpacing() * lines.size() + 4);
+    overlayTimer.start();
+    update(overlayRect);
+}
+
+void CanvasLabel::resizeEvent(QResizeEvent *event){
+    QLabel::resizeEvent(event);
+    if (imageSize.isEmpty())
+        return;
+    setSpriteSize(imageSize);
+    emit viewportChanged();
 }
@@ -0,0 +1,132 @@
+/**
+ * Entry point of a8spriteexport, the headless tool which converts .ssp projects to PNG files from the command
+ * line, or with --bench times the core sprite operations and compares them against a stored baseline.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "batchexporter.h"
+#include "benchmark.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QTextStream>
+#include <cstdio>
+
+int main(int argc, char *argv[]){
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("a8spriteexport");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts sprite editor projects (.ssp) to PNG files. Frames are numbered from 1.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", ".ssp projects, or directories of them, to convert.", "<paths...>");
+    const QCommandLineOption outputOption({"o", "output"}, "Write the PNGs into <dir> instead of next to each project.", "dir");
+    const QCommandLineOption formatOption({"f", "format"}, "What to write: sequence (one PNG per frame), sheet, or both.", "format", "sequence");
+    const QCommandLineOption columnsOption("columns", "Frames per sprite sheet row (default: roughly square).", "n", "0");
+    const QCommandLineOption recursiveOption({"r", "recursive"}, "Also convert projects in subdirectories.");
+    const QCommandLineOption jobsOption({"j", "jobs"}, "Convert <n> projects at once (default: one per core).", "n", "0");
+    const QCommandLineOption benchOption("bench", "Time the core sprite operations instead of converting projects.");
+    const QCommandLineOption benchSizesOption("bench-sizes", "Canvas sizes to benchmark, such as 64,256x128.", "sizes", "64,256,1024");
+    const QCommandLineOption benchFramesOption("bench-frames", "Frame counts to benchmark saving and loading with.", "counts", "1,8,32");
+    const QCommandLineOption benchOutputOption("bench-output", "Write the benchmark results as JSON to <file>.", "file");
+    const QCommandLineOption baselineOption("baseline", "Compare the benchmark results against a JSON <file> from --bench-output.", "file");
+    const QCommandLineOption thresholdOption("threshold", "Percent slower than the baseline that counts as a regression.", "percent", "10");
+    parser.addOptions({outputOption, formatOption, columnsOption, recursiveOption, jobsOption,
+                       benchOption, benchSizesOption, benchFramesOption, benchOutputOption, baselineOption, thresholdOption});
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.isSet(benchOption)) {
+        // Sizes are either a single number for a square canvas or WIDTHxHEIGHT
+        QVector<QSize> sizes;
+        for (const QString& value : parser.value(benchSizesOption).split(',')) {
+            const QStringList parts = value.split('x');
+            const int width = parts.first().toInt();
+            const int height = parts.size() > 1 ? parts.at(1).toInt() : width;
+            if (parts.size() > 2 || width <= 0 || height <= 0 || width > Sprite::MAX_SIZE || height > Sprite::MAX_SIZE) {
+                err << "Invalid benchmark size " << value << "\n";
+                return 2;
+            }
+            sizes.append(QSize(width, height));
+        }
+        QVector<int> frameCounts;
+        for (const QString& value : parser.value(benchFramesOption).split(',')) {
+            if (value.toInt() <= 0) {
+                err << "Invalid benchmark frame count " << value << "\n";
+                return 2;
+            }
+            frameCounts.append(value.toInt());
+        }
+
+        const QVector<Benchmark::Result> results = Benchmark(sizes, frameCounts).run(out);
+
+        if (parser.isSet(benchOutputOption)) {
+            QFile file(parser.value(benchOutputOption));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                err << "Could not write " << file.fileName() << ": " << file.errorString() << "\n";
+                return 1;
+            }
+            file.write(Benchmark::toJson(results).toJson());
+        }
+
+        if (parser.isSet(baselineOption)) {
+            QFile file(parser.value(baselineOption));
+            if (!file.open(QIODevice::ReadOnly)) {
+                err << "Could not read " << file.fileName() << ": " << file.errorString() << "\n";
+                return 1;
+            }
+            out << "\nCompared to " << file.fileName() << ":\n";
+            const QVector<Benchmark::Result> baseline = Benchmark::fromJson(QJsonDocument::fromJson(file.readAll()));
+            const int regressions = Benchmark::compare(results, baseline, parser.value(thresholdOption).toDouble(), out);
+            out << regressions << " regressions\n";
+            return regressions > 0 ? 1 : 0;
+        }
+        return 0;
+    }
+
+    BatchExporter::Options options;
+    options.outputDir = parser.value(outputOption);
+    options.recursive = parser.isSet(recursiveOption);
+    const QString format = parser.value(formatOption);
+    if (format != "sequence" && format != "sheet" && format != "both") {
+        err << "Unknown format " << format << ", expected sequence, sheet or both\n";
+        return 2;
+    }
+    options.sequence = format != "sheet";
+    options.sheet = format != "sequence";
+    bool columnsOk, jobsOk;
+    options.sheetColumns = parser.value(columnsOption).toInt(&columnsOk);
+    options.jobs = parser.value(jobsOption).toInt(&jobsOk);
+    if (!columnsOk || options.sheetColumns < 0 || !jobsOk || options.jobs < 0) {
+        err << "--columns and --jobs must be whole numbers, 0 for the default\n";
+        return 2;
+    }
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(2);
+
+    BatchExporter exporter(options);
+    QStringList errors;
+    const QVector<BatchExporter::Project> projects = exporter.findProjects(parser.positionalArguments(), errors);
+    for (const QString& error : std::as_const(errors))
+        err << error << "\n";
+
+    // Results arrive from the worker threads, so keep their lines from interleaving
+    QMutex outputMutex;
+    const int failures = exporter.run(projects, [&](const BatchExporter::Project& project, int frames, const QString& error) {
+        QMutexLocker locker(&outputMutex);
+        if (error.isEmpty())
+            out << project.path << ": " << frames << " frames\n" << Qt::flush;
+        else
+            err << project.path << ": " << error << "\n" << Qt::flush;
+    });
+
+    out << projects.size() - failures << " of " << projects.size() << " projects exported\n";
+    return failures > 0 || !errors.isEmpty() ? 1 : 0;
+}
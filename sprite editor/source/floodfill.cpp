@@ -0,0 +1,93 @@
+/**
+ * Scanline flood fill used by the fill tool. Works directly on the pixels of a tiled frame, filling whole
+ * horizontal spans at a time and tracking visited pixels in a bitmap.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "floodfill.h"
+#include <cstdlib>
+#include <vector>
+
+bool FloodFill::matches(QRgb pixel, QRgb target, int tolerance){
+    if (tolerance == 0)
+        return pixel == target;
+    return std::abs(qRed(pixel) - qRed(target)) <= tolerance
+        && std::abs(qGreen(pixel) - qGreen(target)) <= tolerance
+        && std::abs(qBlue(pixel) - qBlue(target)) <= tolerance
+        && std::abs(qAlpha(pixel) - qAlpha(target)) <= tolerance;
+}
+
+QRect FloodFill::fill(Frame& frame, QPoint seed, QRgb color, int tolerance, Connectivity connectivity, BlendMode mode){
+    const int width = frame.getWidth();
+    const int height = frame.getHeight();
+    if (!frame.getRect().contains(seed))
+        return QRect();
+
+    const QRgb target = frame.getPixel(seed.x(), seed.y());
+    if ((mode == BlendMode::REPLACE && tolerance == 0 && target == color) || Blend::isNoOp(color, mode))
+        return QRect();
+
+    // One bit per pixel, set once the pixel has been filled
+    std::vector<quint64> visited((qsizetype(width) * height + 63) / 64, 0);
+    auto isVisited = [&](int x, int y) {
+        const qsizetype bit = qsizetype(y) * width + x;
+        return (visited[bit >> 6] >> (bit & 63)) & 1;
+    };
+    auto fillable = [&](int x, int y) {
+        return !isVisited(x, y) && matches(frame.getPixel(x, y), target, tolerance);
+    };
+
+    // Spans reach one pixel further on each side of their parent when diagonals connect
+    const int reach = connectivity == Connectivity::EIGHT ? 1 : 0;
+    int left = seed.x(), right = seed.x(), top = seed.y(), bottom = seed.y();
+
+    std::vector<QPoint> stack;
+    stack.push_back(seed);
+    while (!stack.empty()) {
+        const QPoint point = stack.back();
+        stack.pop_back();
+        const int y = point.y();
+        if (!fillable(point.x(), y))
+            continue;
+
+        // Grow the span as far left and right as it goes, then fill it
+        int spanLeft = point.x();
+        int spanRight = point.x();
+        while (spanLeft > 0 && fillable(spanLeft - 1, y))
+            spanLeft--;
+        while (spanRight < width - 1 && fillable(spanRight + 1, y))
+            spanRight++;
+
+        frame.blendRect(QRect(spanLeft, y, spanRight - spanLeft + 1, 1), color, mode);
+        for (int x = spanLeft; x <= spanRight; x++) {
+            const qsizetype bit = qsizetype(y) * width + x;
+            visited[bit >> 6] |= quint64(1) << (bit & 63);
+        }
+        left = qMin(left, spanLeft);
+        right = qMax(right, spanRight);
+        top = qMin(top, y);
+        bottom = qMax(bottom, y);
+
+        // Queue one seed for each run of fillable pixels touching the span in the rows above and below
+        const int scanLeft = qMax(0, spanLeft - reach);
+        const int scanRight = qMin(width - 1, spanRight + reach);
+        for (int neighborY : {y - 1, y + 1}) {
+            if (neighborY < 0 || neighborY >= height)
+                continue;
+            bool inRun = false;
+            for (int x = scanLeft; x <= scanRight; x++) {
+                if (fillable(x, neighborY)) {
+                    if (!inRun)
+                        stack.push_back(QPoint(x, neighborY));
+                    inRun = true;
+                } else {
+                    inRun = false;
+                }
+            }
+        }
+    }
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
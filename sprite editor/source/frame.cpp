@@ -1,21 +1,318 @@
+/**
+ * Represents one frame of a sprite, stored as a grid of reference counted 16x16 tiles. Copying a frame only
+ * copies the tile pointers, and a tile is cloned the first time it is written to while shared, so frames
+ * which are nearly identical (the common case in animation) share most of their memory.
+ *
+ * A frame holds either ARGB32 tiles or 8-bit indexed tiles read through a palette. Indexed frames still read
+ * and write ARGB32 colors, converting through the palette, so the rest of the editor does not need to know
+ * which a frame is. Colors written to an indexed frame which are not in its palette become the closest one.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
 #include "frame.h"
+#include <algorithm>
+#include <cstring>
+
+Frame::Frame() {}
+
+Frame::Frame(int width, int height, QRgb color) : width{width}, height{height} {
+    columns = (width + TILE_MASK) >> TILE_SHIFT;
+    rows = (height + TILE_MASK) >> TILE_SHIFT;
+
+    // Every tile points at the same filled tile until it is first drawn on
+    QSharedDataPointer<Tile> filled(new Tile);
+    std::fill_n(filled->pixels, TILE_SIZE * TILE_SIZE, color);
+    tiles = QVector<QSharedDataPointer<Tile>>(qsizetype(columns) * rows, filled);
+}
+
+Frame::Frame(int width, int height, const Palette& palette, quint8 index)
+    : width{width}, height{height}, palette{palette} {
+    columns = (width + TILE_MASK) >> TILE_SHIFT;
+    rows = (height + TILE_MASK) >> TILE_SHIFT;
+
+    QSharedDataPointer<IndexedTile> filled(new IndexedTile);
+    std::fill_n(filled->indices, TILE_SIZE * TILE_SIZE, index);
+    indexedTiles = QVector<QSharedDataPointer<IndexedTile>>(qsizetype(columns) * rows, filled);
+}
+
+Frame::Frame(const QImage& image) : Frame(image.width(), image.height()) {
+    for (int y = 0; y < height; y++)
+        writeRow(0, y, width, reinterpret_cast<const QRgb*>(image.constScanLine(y)));
+}
+
+int Frame::getWidth() const{
+    return width;
+}
+
+int Frame::getHeight() const{
+    return height;
+}
+
+QRect Frame::getRect() const{
+    return QRect(0, 0, width, height);
+}
+
+bool Frame::isNull() const{
+    return tiles.isEmpty() && indexedTiles.isEmpty();
+}
+
+const Palette& Frame::getPalette() const{
+    return palette;
+}
+
+void Frame::setPalette(const Palette& palette){
+    this->palette = palette;
+}
+
+Frame Frame::toIndexed(const Palette& palette) const{
+    Frame indexed(width, height, palette, 0);
+    QVector<QRgb> row(width);
+    for (int y = 0; y < height; y++) {
+        readRow(0, y, width, row.data());
+        indexed.writeRow(0, y, width, row.constData());
+    }
+    return indexed;
+}
+
+Frame Frame::toArgb() const{
+    Frame argb(width, height);
+    QVector<QRgb> row(width);
+    for (int y = 0; y < height; y++) {
+        readRow(0, y, width, row.data());
+        argb.writeRow(0, y, width, row.constData());
+    }
+    return argb;
+}
+
+QRect Frame::fillRect(QRect rect, QRgb color){
+    const QRect clipped = rect.intersected(getRect());
+    const quint8 index = isIndexed() ? palette.indexOf(color) : 0;
+    for (int y = clipped.top(); y <= clipped.bottom(); y++) {
+        const int rowOffset = (y & TILE_MASK) << TILE_SHIFT;
+        for (int x = clipped.left(); x <= clipped.right(); ) {
+            const int run = qMin(clipped.right() + 1 - x, TILE_SIZE - (x & TILE_MASK));
+            if (isIndexed())
+                std::fill_n(indexedTile(x, y).indices + rowOffset + (x & TILE_MASK), run, index);
+            else
+                std::fill_n(tile(x, y).pixels + rowOffset + (x & TILE_MASK), run, color);
+            x += run;
+        }
+    }
+    return clipped;
+}
 
-Frame::Frame(int width, int height) : width{width}, height{height} {
-    // Initialize the image data to the correct width and height with blank white pixels
-    imageData = vector<vector<QColor>>(height, vector<QColor>(width, QColor(255,255,255,255)));
+QRect Frame::blendRect(QRect rect, QRgb color, BlendMode mode){
+    if (mode == BlendMode::REPLACE)
+        return fillRect(rect, color);
+
+    const QRect clipped = rect.intersected(getRect());
+    if (Blend::isNoOp(color, mode))
+        return clipped;
+    QRgb row[TILE_SIZE];
+    for (int y = clipped.top(); y <= clipped.bottom(); y++) {
+        const int rowOffset = (y & TILE_MASK) << TILE_SHIFT;
+        for (int x = clipped.left(); x <= clipped.right(); ) {
+            const int run = qMin(clipped.right() + 1 - x, TILE_SIZE - (x & TILE_MASK));
+            if (isIndexed()) {
+                // Indexed rows are blended as colors and indexed again
+                readRow(x, y, run, row);
+                Blend::blendSpan(row, row, run, color, mode);
+                writeRow(x, y, run, row);
+            } else {
+                QRgb* pixels = tile(x, y).pixels + rowOffset + (x & TILE_MASK);
+                Blend::blendSpan(pixels, pixels, run, color, mode);
+            }
+            x += run;
+        }
+    }
+    return clipped;
+}
+
+void Frame::readRow(int x, int y, int count, QRgb* out) const{
+    const int rowOffset = (y & TILE_MASK) << TILE_SHIFT;
+    while (count > 0) {
+        const int run = qMin(count, TILE_SIZE - (x & TILE_MASK));
+        if (isIndexed()) {
+            const quint8* indices = constIndexedTile(x, y).indices + rowOffset + (x & TILE_MASK);
+            for (int i = 0; i < run; i++)
+                out[i] = palette.color(indices[i]);
+        } else {
+            std::memcpy(out, constTile(x, y).pixels + rowOffset + (x & TILE_MASK), run * sizeof(QRgb));
+        }
+        x += run;
+        out += run;
+        count -= run;
+    }
+}
+
+void Frame::writeRow(int x, int y, int count, const QRgb* in){
+    const int rowOffset = (y & TILE_MASK) << TILE_SHIFT;
+
+    // Rows are mostly runs of one color, so remember the last lookup rather than searching for every pixel
+    QRgb lastColor = 0;
+    quint8 lastIndex = isIndexed() ? palette.indexOf(0) : 0;
+    while (count > 0) {
+        const int run = qMin(count, TILE_SIZE - (x & TILE_MASK));
+        if (isIndexed()) {
+            quint8* indices = indexedTile(x, y).indices + rowOffset + (x & TILE_MASK);
+            for (int i = 0; i < run; i++) {
+                if (in[i] != lastColor) {
+                    lastColor = in[i];
+                    lastIndex = palette.indexOf(lastColor);
+                }
+                indices[i] = lastIndex;
+            }
+        } else {
+            std::memcpy(tile(x, y).pixels + rowOffset + (x & TILE_MASK), in, run * sizeof(QRgb));
+        }
+        x += run;
+        in += run;
+        count -= run;
+    }
+}
+
+void Frame::readRect(QRect rect, QRgb* out) const{
+    for (int y = rect.top(); y <= rect.bottom(); y++, out += rect.width())
+        readRow(rect.left(), y, rect.width(), out);
+}
+
+void Frame::writeRect(QRect rect, const QRgb* in){
+    for (int y = rect.top(); y <= rect.bottom(); y++, in += rect.width())
+        writeRow(rect.left(), y, rect.width(), in);
+}
+
+void Frame::readIndices(QRect rect, quint8* out) const{
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        const int rowOffset = (y & TILE_MASK) << TILE_SHIFT;
+        for (int x = rect.left(); x <= rect.right(); ) {
+            const int run = qMin(rect.right() + 1 - x, TILE_SIZE - (x & TILE_MASK));
+            std::memcpy(out, constIndexedTile(x, y).indices + rowOffset + (x & TILE_MASK), run);
+            x += run;
+            out += run;
+        }
+    }
+}
+
+void Frame::writeIndices(QRect rect, const quint8* in){
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        const int rowOffset = (y & TILE_MASK) << TILE_SHIFT;
+        for (int x = rect.left(); x <= rect.right(); ) {
+            const int run = qMin(rect.right() + 1 - x, TILE_SIZE - (x & TILE_MASK));
+            std::memcpy(indexedTile(x, y).indices + rowOffset + (x & TILE_MASK), in, run);
+            x += run;
+            in += run;
+        }
+    }
 }
 
-Frame::Frame(vector<vector<QColor>>& imageData) {
+int Frame::getTileColumns() const{
+    return columns;
+}
+
+int Frame::getTileRows() const{
+    return rows;
+}
+
+QRect Frame::tileRect(int column, int row) const{
+    return QRect(column << TILE_SHIFT, row << TILE_SHIFT, TILE_SIZE, TILE_SIZE).intersected(getRect());
+}
+
+bool Frame::sharesTile(const Frame& other, int column, int row) const{
+    if (columns != other.columns || isIndexed() != other.isIndexed())
+        return false;
+    const qsizetype index = qsizetype(row) * columns + column;
+    if (isIndexed())
+        return indexedTiles.at(index).constData() == other.indexedTiles.at(index).constData() && palette == other.palette;
+    return tiles.at(index).constData() == other.tiles.at(index).constData();
+}
 
-    this->height = imageData.size();
-    this->width = (height > 0) ? imageData[0].size() : 0;
-    this->imageData = imageData;
+bool Frame::sharesTiles(const Frame& other) const{
+    if (width != other.width || height != other.height)
+        return false;
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            if (!sharesTile(other, column, row))
+                return false;
+        }
+    }
+    return true;
 }
 
-Frame::~Frame(){
+bool Frame::tileEquals(const Frame& other, int column, int row) const{
+    if (sharesTile(other, column, row))
+        return true;
+
+    // Only compare the part of an edge tile which lies inside the frame
+    const QRect rect = tileRect(column, row);
+    const qsizetype index = qsizetype(row) * columns + column;
+    if (!isIndexed() && !other.isIndexed()) {
+        const QRgb* pixels = tiles.at(index).constData()->pixels;
+        const QRgb* otherPixels = other.tiles.at(index).constData()->pixels;
+        for (int y = 0; y < rect.height(); y++) {
+            if (std::memcmp(pixels + (y << TILE_SHIFT), otherPixels + (y << TILE_SHIFT), rect.width() * sizeof(QRgb)) != 0)
+                return false;
+        }
+        return true;
+    }
+    if (isIndexed() && other.isIndexed() && palette == other.palette) {
+        const quint8* indices = indexedTiles.at(index).constData()->indices;
+        const quint8* otherIndices = other.indexedTiles.at(index).constData()->indices;
+        for (int y = 0; y < rect.height(); y++) {
+            if (std::memcmp(indices + (y << TILE_SHIFT), otherIndices + (y << TILE_SHIFT), rect.width()) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Frames of different formats or palettes can only be compared by color
+    QRgb pixels[TILE_SIZE];
+    QRgb otherPixels[TILE_SIZE];
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        readRow(rect.left(), y, rect.width(), pixels);
+        other.readRow(rect.left(), y, rect.width(), otherPixels);
+        if (std::memcmp(pixels, otherPixels, rect.width() * sizeof(QRgb)) != 0)
+            return false;
+    }
+    return true;
+}
+
+void Frame::shareIdenticalTiles(const Frame& reference){
+    if (reference.width != width || reference.height != height || reference.isIndexed() != isIndexed())
+        return;
+    if (isIndexed() && reference.palette != palette)
+        return;
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            if (!tileEquals(reference, column, row))
+                continue;
+            if (isIndexed())
+                indexedTiles[row * columns + column] = reference.indexedTiles.at(row * columns + column);
+            else
+                tiles[row * columns + column] = reference.tiles.at(row * columns + column);
+        }
+    }
+}
+
+QImage Frame::toImage() const{
+    return toImage(getRect());
+}
 
+QImage Frame::toImage(QRect rect) const{
+    QImage image(rect.size(), QImage::Format_ARGB32);
+    for (int y = 0; y < rect.height(); y++)
+        readRow(rect.left(), rect.top() + y, rect.width(), reinterpret_cast<QRgb*>(image.scanLine(y)));
+    return image;
 }
 
-void Frame::setPixel(int x, int y, QColor color){
-    imageData[y][x] = color;
+QImage Frame::toImage(QSize size) const{
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < size.height(); y++) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const int sourceY = int(qint64(y) * height / size.height());
+        for (int x = 0; x < size.width(); x++)
+            line[x] = getPixel(int(qint64(x) * width / size.width()), sourceY);
+    }
+    return image;
 }
@@ -0,0 +1,80 @@
+/**
+ * The list of frames shown in the frame strip. Items are only data, so the strip's view only creates what is
+ * on screen no matter how many frames there are. Each frame has a revision which goes up whenever the frame
+ * changes; thumbnails are requested for the current revision and any finished for an older one are ignored.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "framelistmodel.h"
+
+FrameListModel::FrameListModel(QObject *parent) : QAbstractListModel(parent) {}
+
+int FrameListModel::rowCount(const QModelIndex& parent) const{
+    return parent.isValid() ? 0 : int(items.size());
+}
+
+QVariant FrameListModel::data(const QModelIndex& index, int role) const{
+    if (!index.isValid() || index.row() >= items.size())
+        return QVariant();
+
+    const Item& item = items[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return "Frame " + QString::number(index.row() + 1);
+    case Qt::DecorationRole:
+        if (item.thumbnailRevision != item.revision && !item.requested) {
+            // The view only asks for the items it shows, so only visible frames get thumbnails made
+            FrameListModel* self = const_cast<FrameListModel*>(this);
+            self->items[index.row()].requested = true;
+            emit self->thumbnailRequested(index.row(), item.revision, THUMBNAIL_SIZE);
+        }
+        return item.thumbnail.isNull() ? QVariant() : QVariant(item.thumbnail);
+    default:
+        return QVariant();
+    }
+}
+
+int FrameListModel::getFrameCount() const{
+    return int(items.size());
+}
+
+void FrameListModel::setFrameCount(int frameCount){
+    const int oldCount = int(items.size());
+    if (frameCount > oldCount) {
+        beginInsertRows(QModelIndex(), oldCount, frameCount - 1);
+        items.resize(frameCount);
+        for (int i = oldCount; i < frameCount; i++)
+            items[i].revision = nextRevision++;
+        endInsertRows();
+    } else if (frameCount < oldCount) {
+        beginRemoveRows(QModelIndex(), frameCount, oldCount - 1);
+        items.resize(frameCount);
+        endRemoveRows();
+    }
+}
+
+void FrameListModel::setThumbnail(int frameIndex, quint64 revision, const QImage& thumbnail){
+    if (frameIndex >= items.size() || items[frameIndex].revision != revision)
+        return;
+
+    Item& item = items[frameIndex];
+    item.thumbnail = QPixmap::fromImage(thumbnail);
+    item.thumbnailRevision = revision;
+    item.requested = false;
+    emit dataChanged(index(frameIndex), index(frameIndex), {Qt::DecorationRole});
+}
+
+void FrameListModel::invalidate(int firstFrame, int lastFrame){
+    if (lastFrame < 0 || lastFrame >= items.size())
+        lastFrame = int(items.size()) - 1;
+    if (firstFrame > lastFrame)
+        return;
+
+    for (int i = firstFrame; i <= lastFrame; i++) {
+        items[i].revision = nextRevision++;
+        items[i].requested = false;
+    }
+    emit dataChanged(index(firstFrame), index(lastFrame), {Qt::DecorationRole});
+}
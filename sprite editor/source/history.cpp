@@ -0,0 +1,369 @@
+/**
+ * The undo/redo history of a project. Pixel edits are recorded as compressed deltas of only the 16x16 tiles
+ * they changed, and frame and layer operations as the minimum needed to reverse them, so memory scales
+ * with how much was changed rather than with the size of the frames. The oldest entries are evicted once
+ * the history grows past its byte budget.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "history.h"
+
+History::History(qsizetype budget) : budget{budget} {}
+
+void History::setBudget(qsizetype budget){
+    this->budget = budget;
+    evict();
+}
+
+qsizetype History::getUsedBytes() const{
+    return usedBytes;
+}
+
+qsizetype History::Entry::cost() const{
+    qsizetype layerBytes = 0;
+    for (const Layer& layer : layers)
+        layerBytes += sizeof(Layer) + qsizetype(layer.pixels.getWidth()) * layer.pixels.getHeight() * sizeof(QRgb);
+    qsizetype partBytes = 0;
+    for (const Entry& part : parts)
+        partBytes += part.cost();
+    return sizeof(Entry) + tiles.size() * sizeof(QPoint) + before.size() + after.size() + layerBytes + partBytes;
+}
+
+void History::push(Entry entry){
+    for (const Entry& redoEntry : redoEntries)
+        usedBytes -= redoEntry.cost();
+    redoEntries.clear();
+
+    usedBytes += entry.cost();
+    undoEntries.push_back(std::move(entry));
+    evict();
+}
+
+void History::evict(){
+    while (usedBytes > budget && undoEntries.size() > 1) {
+        usedBytes -= undoEntries.front().cost();
+        undoEntries.pop_front();
+    }
+}
+
+void History::appendTile(QByteArray& buffer, const Frame& frame, QRect tile){
+    const qsizetype offset = buffer.size();
+    buffer.resize(offset + qsizetype(tile.width()) * tile.height() * sizeof(QRgb));
+    frame.readRect(tile, reinterpret_cast<QRgb*>(buffer.data() + offset));
+}
+
+void History::writeTiles(Sprite& sprite, int frameIndex, int layerIndex, const QVector<QPoint>& tiles, const QByteArray& compressed){
+    const QByteArray raw = qUncompress(compressed);
+    const QRgb* data = reinterpret_cast<const QRgb*>(raw.constData());
+    Frame& frame = sprite.getLayerPixels(frameIndex, layerIndex);
+    QRect written;
+    for (const QPoint& corner : tiles) {
+        const QRect tile = frame.tileRect(corner.x() / TILE_SIZE, corner.y() / TILE_SIZE);
+        frame.writeRect(tile, data);
+        data += tile.width() * tile.height();
+        written |= tile;
+    }
+    sprite.layerEdited(frameIndex, layerIndex, written);
+}
+
+History::Entry History::pixelEntry(int frameIndex, int layerIndex, const Frame& before, const Frame& after, QRect dirtyRect){
+    Entry entry{EntryType::PIXELS, frameIndex, {}, {}, {}};
+    dirtyRect &= after.getRect();
+    if (dirtyRect.isEmpty())
+        return entry;
+
+    entry.layerIndex = layerIndex;
+    QByteArray beforeRaw, afterRaw;
+
+    // Walk the tile grid over the dirty rectangle, keeping only the tiles which actually changed
+    for (int row = dirtyRect.top() / TILE_SIZE; row <= dirtyRect.bottom() / TILE_SIZE; row++) {
+        for (int column = dirtyRect.left() / TILE_SIZE; column <= dirtyRect.right() / TILE_SIZE; column++) {
+            if (after.tileEquals(before, column, row))
+                continue;
+            const QRect tile = after.tileRect(column, row);
+            entry.tiles.append(tile.topLeft());
+            appendTile(beforeRaw, before, tile);
+            appendTile(afterRaw, after, tile);
+        }
+    }
+    if (entry.tiles.isEmpty())
+        return entry;
+
+    entry.before = qCompress(beforeRaw);
+    entry.after = qCompress(afterRaw);
+    return entry;
+}
+
+void History::recordPixels(int frameIndex, int layerIndex, const Frame& before, const Frame& after, QRect dirtyRect){
+    Entry entry = pixelEntry(frameIndex, layerIndex, before, after, dirtyRect);
+    if (!entry.tiles.isEmpty())
+        push(std::move(entry));
+}
+
+void History::recordFrameAdded(int frameIndex){
+    push(Entry{EntryType::ADD_FRAME, frameIndex, {}, {}, {}});
+}
+
+void History::recordFrameDeleted(int frameIndex, const Frame& frame, const QVector<Layer>& layers){
+    // The layers are kept as they are, as compressing every one of them would stall the deletion
+    if (!layers.isEmpty()) {
+        Entry entry{EntryType::DELETE_FRAME, frameIndex, {}, {}, {}};
+        entry.layers = layers;
+        push(std::move(entry));
+        return;
+    }
+
+    QByteArray raw;
+    appendTile(raw, frame, frame.getRect());
+    push(Entry{EntryType::DELETE_FRAME, frameIndex, {}, qCompress(raw), {}});
+}
+
+void History::recordFrameDuplicated(int frameIndex){
+    push(Entry{EntryType::DUPLICATE_FRAME, frameIndex, {}, {}, {}});
+}
+
+void History::recordLayerAdded(int frameIndex, int layerIndex){
+    Entry entry{EntryType::ADD_LAYER, frameIndex, {}, {}, {}};
+    entry.layerIndex = layerIndex;
+    push(std::move(entry));
+}
+
+void History::recordLayerDeleted(int frameIndex, int layerIndex, const Layer& layer){
+    Entry entry{EntryType::DELETE_LAYER, frameIndex, {}, {}, {}};
+    entry.layerIndex = layerIndex;
+    entry.layers = {layer};
+    push(std::move(entry));
+}
+
+void History::recordLayerChanged(int frameIndex, int layerIndex, const Layer& before, const Layer& after){
+    // Only the properties are needed, not the pixels
+    Entry entry{EntryType::SET_LAYER, frameIndex, {}, {}, {}};
+    entry.layerIndex = layerIndex;
+    entry.layers = {before, after};
+    for (Layer& layer : entry.layers)
+        layer.pixels = Frame();
+    push(std::move(entry));
+}
+
+void History::recordTransform(int firstFrame, int lastFrame, const FrameTransform& transform){
+    Entry entry{EntryType::TRANSFORM, firstFrame, {}, {}, {}};
+    entry.lastFrameIndex = lastFrame;
+    entry.transform = transform;
+    push(std::move(entry));
+}
+
+void History::recordFrameEdits(const QVector<Sprite::FrameEdit>& edits){
+    // Layers left sharing every tile were not touched, so only the others are compared
+    QVector<std::pair<int, int>> changedLayers;
+    for (int i = 0; i < edits.size(); i++) {
+        for (int layer = 0; layer < edits[i].after.size(); layer++) {
+            if (!edits[i].after[layer].pixels.sharesTiles(edits[i].before[layer].pixels))
+                changedLayers.append({i, layer});
+        }
+    }
+
+    std::vector<Entry> parts(changedLayers.size());
+    Sprite::parallelFor(changedLayers.size(), [&](int i) {
+        const Sprite::FrameEdit& edit = edits[changedLayers[i].first];
+        const int layer = changedLayers[i].second;
+        const Frame& after = edit.after[layer].pixels;
+        parts[i] = pixelEntry(edit.frameIndex, layer, edit.before[layer].pixels, after, after.getRect());
+    });
+
+    Entry entry{EntryType::PIXEL_BATCH, 0, {}, {}, {}};
+    for (Entry& part : parts) {
+        if (!part.tiles.isEmpty())
+            entry.parts.push_back(std::move(part));
+    }
+    if (entry.parts.empty())
+        return;
+    entry.frameIndex = entry.parts.front().frameIndex;
+    entry.lastFrameIndex = entry.parts.back().frameIndex;
+    push(std::move(entry));
+}
+
+void History::recordPaletteColors(int frameIndex, const QVector<int>& indices, QRgb before, QRgb after){
+    Entry entry{EntryType::SET_PALETTE, frameIndex, {}, {}, {}};
+    entry.paletteIndices = indices;
+    entry.colorBefore = before;
+    entry.colorAfter = after;
+    push(std::move(entry));
+}
+
+bool History::setPaletteColors(Sprite& sprite, const QVector<int>& indices, QRgb color){
+    if (!sprite.isIndexed())
+        return false;
+    for (int index : indices) {
+        if (index >= sprite.getPalette().size())
+            return false;
+    }
+    for (int index : indices)
+        sprite.setPaletteColor(index, color);
+    return true;
+}
+
+int History::undo(Sprite& sprite, Change* change){
+    if (undoEntries.empty())
+        return -1;
+
+    Entry entry = std::move(undoEntries.back());
+    undoEntries.pop_back();
+
+    int changedFrame = entry.frameIndex;
+    Change applied{ChangeType::PIXELS, entry.frameIndex, {}, entry.layerIndex};
+    switch (entry.type) {
+    case EntryType::PIXELS:
+        writeTiles(sprite, entry.frameIndex, entry.layerIndex, entry.tiles, entry.before);
+        applied.tiles = entry.tiles;
+        break;
+    case EntryType::ADD_FRAME:
+        sprite.deleteFrame(entry.frameIndex);
+        changedFrame = entry.frameIndex - 1;
+        applied.type = ChangeType::DELETE_FRAME;
+        break;
+    case EntryType::DELETE_FRAME: {
+        applied.type = ChangeType::INSERT_FRAME;
+        if (!entry.layers.isEmpty()) {
+            sprite.insertFrame(entry.frameIndex, entry.layers);
+            break;
+        }
+        const QByteArray raw = qUncompress(entry.before);
+        Frame frame(sprite.getWidth(), sprite.getHeight());
+        frame.writeRect(frame.getRect(), reinterpret_cast<const QRgb*>(raw.constData()));
+        sprite.insertFrame(entry.frameIndex, frame);
+        break;
+    }
+    case EntryType::DUPLICATE_FRAME:
+        sprite.deleteFrame(entry.frameIndex + 1);
+        applied = Change{ChangeType::DELETE_FRAME, entry.frameIndex + 1, {}};
+        break;
+    case EntryType::ADD_LAYER:
+        sprite.deleteLayer(entry.frameIndex, entry.layerIndex);
+        applied.type = ChangeType::DELETE_LAYER;
+        break;
+    case EntryType::DELETE_LAYER:
+        // A sprite indexed since has no layers, and reports an empty pixel change instead
+        if (sprite.insertLayer(entry.frameIndex, entry.layerIndex, entry.layers.first()))
+            applied.type = ChangeType::INSERT_LAYER;
+        break;
+    case EntryType::SET_LAYER: {
+        const Layer& before = entry.layers.first();
+        sprite.setLayerProperties(entry.frameIndex, entry.layerIndex, before.visible, before.opacity, before.mode);
+        applied.type = ChangeType::SET_LAYER;
+        break;
+    }
+    case EntryType::TRANSFORM:
+        sprite.transformFrames(entry.frameIndex, entry.lastFrameIndex, entry.transform.inverse());
+        applied.type = ChangeType::TRANSFORM;
+        applied.lastFrameIndex = entry.lastFrameIndex;
+        applied.transform = entry.transform.inverse();
+        break;
+    case EntryType::PIXEL_BATCH:
+        for (auto part = entry.parts.rbegin(); part != entry.parts.rend(); ++part) {
+            writeTiles(sprite, part->frameIndex, part->layerIndex, part->tiles, part->before);
+            applied.parts.push_back(Change{ChangeType::PIXELS, part->frameIndex, part->tiles, part->layerIndex});
+        }
+        applied.type = ChangeType::PIXEL_BATCH;
+        applied.lastFrameIndex = entry.lastFrameIndex;
+        break;
+    case EntryType::SET_PALETTE:
+        applied.type = ChangeType::SET_PALETTE;
+        if (setPaletteColors(sprite, entry.paletteIndices, entry.colorBefore)) {
+            applied.paletteIndices = entry.paletteIndices;
+            applied.color = entry.colorBefore;
+        }
+        break;
+    }
+    if (change != nullptr)
+        *change = std::move(applied);
+
+    redoEntries.push_back(std::move(entry));
+    return qMax(0, changedFrame);
+}
+
+int History::redo(Sprite& sprite, Change* change){
+    if (redoEntries.empty())
+        return -1;
+
+    Entry entry = std::move(redoEntries.back());
+    redoEntries.pop_back();
+
+    int changedFrame = entry.frameIndex;
+    Change applied{ChangeType::PIXELS, entry.frameIndex, {}, entry.layerIndex};
+    switch (entry.type) {
+    case EntryType::PIXELS:
+        writeTiles(sprite, entry.frameIndex, entry.layerIndex, entry.tiles, entry.after);
+        applied.tiles = entry.tiles;
+        break;
+    case EntryType::ADD_FRAME:
+        sprite.addFrame();
+        applied.type = ChangeType::ADD_FRAME;
+        break;
+    case EntryType::DELETE_FRAME:
+        sprite.deleteFrame(entry.frameIndex);
+        changedFrame = qMin(entry.frameIndex, sprite.getFrameCount() - 1);
+        applied.type = ChangeType::DELETE_FRAME;
+        break;
+    case EntryType::DUPLICATE_FRAME:
+        sprite.duplicateFrame(entry.frameIndex);
+        changedFrame = entry.frameIndex + 1;
+        applied.type = ChangeType::DUPLICATE_FRAME;
+        break;
+    case EntryType::ADD_LAYER:
+        if (sprite.addLayer(entry.frameIndex, entry.layerIndex))
+            applied.type = ChangeType::ADD_LAYER;
+        break;
+    case EntryType::DELETE_LAYER:
+        sprite.deleteLayer(entry.frameIndex, entry.layerIndex);
+        applied.type = ChangeType::DELETE_LAYER;
+        break;
+    case EntryType::SET_LAYER: {
+        const Layer& after = entry.layers.last();
+        sprite.setLayerProperties(entry.frameIndex, entry.layerIndex, after.visible, after.opacity, after.mode);
+        applied.type = ChangeType::SET_LAYER;
+        break;
+    }
+    case EntryType::TRANSFORM:
+        sprite.transformFrames(entry.frameIndex, entry.lastFrameIndex, entry.transform);
+        applied.type = ChangeType::TRANSFORM;
+        applied.lastFrameIndex = entry.lastFrameIndex;
+        applied.transform = entry.transform;
+        break;
+    case EntryType::PIXEL_BATCH:
+        for (const Entry& part : entry.parts) {
+            writeTiles(sprite, part.frameIndex, part.layerIndex, part.tiles, part.after);
+            applied.parts.push_back(Change{ChangeType::PIXELS, part.frameIndex, part.tiles, part.layerIndex});
+        }
+        applied.type = ChangeType::PIXEL_BATCH;
+        applied.lastFrameIndex = entry.lastFrameIndex;
+        break;
+    case EntryType::SET_PALETTE:
+        applied.type = ChangeType::SET_PALETTE;
+        if (setPaletteColors(sprite, entry.paletteIndices, entry.colorAfter)) {
+            applied.paletteIndices = entry.paletteIndices;
+            applied.color = entry.colorAfter;
+        }
+        break;
+    }
+    if (change != nullptr)
+        *change = std::move(applied);
+
+    undoEntries.push_back(std::move(entry));
+    return changedFrame;
+}
+
+bool History::canUndo() const{
+    return !undoEntries.empty();
+}
+
+bool History::canRedo() const{
+    return !redoEntries.empty();
+}
+
+void History::clear(){
+    undoEntries.clear();
+    redoEntries.clear();
+    usedBytes = 0;
+}
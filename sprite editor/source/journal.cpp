@@ -0,0 +1,472 @@
+/**
+ * An append-only journal of the edits made to a project, so the project can be recovered after a crash.
+ * Each edit appends a compact binary record of only what it changed, so keeping the journal costs as much
+ * as the edits rather than the size of the project. Once the journal grows large it is compacted by
+ * writing a full snapshot of the sprite in the background and starting a new, empty journal.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "journal.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <memory>
+
+/**
+ * Returns the generation in a snapshot or journal file name, or -1 if the name has none.
+ */
+static int generationOf(const QString& fileName){
+    bool ok;
+    const int generation = fileName.section('-', 1).section('.', 0, 0).toInt(&ok);
+    return ok ? generation : -1;
+}
+
+Journal::Journal(const QString& directory) : directory{directory}, lock{QDir(directory).filePath("recovery.lock")} {
+    QDir().mkpath(directory);
+
+    // Editor sessions last hours, so a lock is only stale once the editor holding it has died
+    lock.setStaleLockTime(0);
+    enabled = lock.tryLock(0);
+    if (!enabled)
+        qDebug() << "Another editor is using" << directory << "so edits will not be journaled";
+
+    snapshotPool.setMaxThreadCount(1);
+}
+
+Journal::~Journal(){
+    snapshotPool.waitForDone();
+}
+
+QString Journal::snapshotPath(int generation) const{
+    return directory.filePath(QString("snapshot-%1.ssp").arg(generation));
+}
+
+QString Journal::journalPath(int generation) const{
+    return directory.filePath(QString("journal-%1.log").arg(generation));
+}
+
+QVector<int> Journal::generations(const QString& prefix) const{
+    QVector<int> found;
+    for (const QString& name : directory.entryList({prefix + "-*"}, QDir::Files)) {
+        // Skip the temporary files of snapshots still being written
+        const int generation = generationOf(name);
+        if (generation >= 0 && (directory.filePath(name) == snapshotPath(generation) || directory.filePath(name) == journalPath(generation)))
+            found.append(generation);
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+bool Journal::hasRecovery() const{
+    return enabled && !generations("snapshot").isEmpty();
+}
+
+Sprite* Journal::recover() const{
+    if (!enabled)
+        return nullptr;
+
+    // Fall back to an older snapshot if the newest cannot be read
+    const QVector<int> snapshots = generations("snapshot");
+    for (int i = snapshots.size() - 1; i >= 0; i--) {
+        QFile snapshotFile(snapshotPath(snapshots[i]));
+        if (!snapshotFile.open(QIODevice::ReadOnly))
+            continue;
+        std::unique_ptr<Sprite> sprite(Sprite::Deserialize(snapshotFile));
+        if (!sprite)
+            continue;
+
+        // Each journal continues from the one before, so replay stops at the first which is cut short
+        for (int generation = snapshots[i]; ; generation++) {
+            QFile journalFile(journalPath(generation));
+            if (!journalFile.open(QIODevice::ReadOnly) || !replay(*sprite, journalFile, generation))
+                break;
+        }
+        return sprite.release();
+    }
+    return nullptr;
+}
+
+void Journal::start(const Sprite& sprite){
+    if (!enabled)
+        return;
+    discard();
+    beginGeneration(sprite);
+}
+
+void Journal::beginGeneration(const Sprite& sprite){
+    generation++;
+    file.close();
+    file.setFileName(journalPath(generation));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to open journal:" << file.errorString();
+        return;
+    }
+    QByteArray header;
+    QDataStream(&header, QIODevice::WriteOnly) << JOURNAL_MAGIC << qint32(generation);
+    file.write(header);
+    file.flush();
+
+    // Copying the sprite only copies its tile pointers, and edits made during the snapshot clone the tiles
+    const std::shared_ptr<Sprite> snapshot = std::make_shared<Sprite>(sprite);
+    const QString path = snapshotPath(generation);
+    const QString directoryPath = directory.path();
+    const int snapshotGeneration = generation;
+    snapshotPool.start([snapshot, path, directoryPath, snapshotGeneration]() {
+        QSaveFile out(path);
+        if (!out.open(QIODevice::WriteOnly) || !snapshot->Serialize(out) || !out.commit()) {
+            qDebug() << "Failed to write recovery snapshot:" << out.errorString();
+            return;
+        }
+
+        // The snapshot covers every edit of the older generations, so they are no longer needed
+        QDir dir(directoryPath);
+        for (const QString& name : dir.entryList({"snapshot-*", "journal-*"}, QDir::Files)) {
+            const int fileGeneration = generationOf(name);
+            if (fileGeneration >= 0 && fileGeneration < snapshotGeneration)
+                dir.remove(name);
+        }
+    });
+}
+
+void Journal::compactIfLarge(const Sprite& sprite){
+    if (file.isOpen() && file.size() > COMPACT_SIZE)
+        beginGeneration(sprite);
+}
+
+void Journal::discard(){
+    if (!enabled)
+        return;
+    snapshotPool.waitForDone();
+    file.close();
+    for (const QString& name : directory.entryList({"snapshot-*", "journal-*"}, QDir::Files))
+        directory.remove(name);
+    generation = 0;
+}
+
+void Journal::append(RecordType type, int frameIndex, const QByteArray& payload){
+    if (!file.isOpen())
+        return;
+
+    // Written in one piece, so a crash can only cut off the end of the last record
+    QByteArray record;
+    QDataStream(&record, QIODevice::WriteOnly) << quint8(type) << qint32(frameIndex) << quint32(payload.size());
+    record.append(payload);
+    file.write(record);
+    file.flush();
+}
+
+QByteArray Journal::packTiles(int layerIndex, const Frame& frame, const QVector<QPoint>& tiles){
+    QByteArray payload;
+    QByteArray raw;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << qint32(layerIndex) << qint32(tiles.size());
+        for (const QPoint& corner : tiles) {
+            stream << qint32(corner.x()) << qint32(corner.y());
+
+            const QRect tile = frame.tileRect(corner.x() / Frame::TILE_SIZE, corner.y() / Frame::TILE_SIZE);
+            const qsizetype offset = raw.size();
+            raw.resize(offset + qsizetype(tile.width()) * tile.height() * sizeof(QRgb));
+            QRgb* pixels = reinterpret_cast<QRgb*>(raw.data() + offset);
+            frame.readRect(tile, pixels);
+            qToLittleEndian<quint32>(pixels, qsizetype(tile.width()) * tile.height(), pixels);
+        }
+    }
+    payload.append(qCompress(raw));
+    return payload;
+}
+
+void Journal::recordPixels(int frameIndex, int layerIndex, const Frame& before, const Frame& after, QRect dirtyRect){
+    dirtyRect &= after.getRect();
+    if (!file.isOpen() || dirtyRect.isEmpty())
+        return;
+
+    QVector<QPoint> tiles;
+    for (int row = dirtyRect.top() / Frame::TILE_SIZE; row <= dirtyRect.bottom() / Frame::TILE_SIZE; row++) {
+        for (int column = dirtyRect.left() / Frame::TILE_SIZE; column <= dirtyRect.right() / Frame::TILE_SIZE; column++) {
+            if (!after.tileEquals(before, column, row))
+                tiles.append(after.tileRect(column, row).topLeft());
+        }
+    }
+    if (!tiles.isEmpty())
+        append(RecordType::PIXELS, frameIndex, packTiles(layerIndex, after, tiles));
+}
+
+void Journal::recordFrameAdded(){
+    append(RecordType::ADD_FRAME, 0, {});
+}
+
+void Journal::recordFrameInserted(int frameIndex, const Frame& frame){
+    if (!file.isOpen())
+        return;
+    QByteArray raw(qsizetype(frame.getWidth()) * frame.getHeight() * sizeof(QRgb), Qt::Uninitialized);
+    QRgb* pixels = reinterpret_cast<QRgb*>(raw.data());
+    frame.readRect(frame.getRect(), pixels);
+    qToLittleEndian<quint32>(pixels, qsizetype(frame.getWidth()) * frame.getHeight(), pixels);
+    append(RecordType::INSERT_FRAME, frameIndex, qCompress(raw));
+}
+
+void Journal::recordFrameDeleted(int frameIndex){
+    append(RecordType::DELETE_FRAME, frameIndex, {});
+}
+
+void Journal::recordFrameDuplicated(int frameIndex){
+    append(RecordType::DUPLICATE_FRAME, frameIndex, {});
+}
+
+void Journal::recordPaletteColor(int index, QRgb color){
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << quint32(color);
+    append(RecordType::SET_PALETTE_COLOR, index, payload);
+}
+
+void Journal::recordLayerAdded(int frameIndex, int layerIndex){
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << qint32(layerIndex);
+    append(RecordType::ADD_LAYER, frameIndex, payload);
+}
+
+void Journal::recordLayerDeleted(int frameIndex, int layerIndex){
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << qint32(layerIndex);
+    append(RecordType::DELETE_LAYER, frameIndex, payload);
+}
+
+void Journal::recordLayerChanged(int frameIndex, int layerIndex, const Layer& layer){
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << qint32(layerIndex) << quint8(layer.visible) << quint8(layer.opacity) << quint8(layer.mode);
+    append(RecordType::SET_LAYER, frameIndex, payload);
+}
+
+void Journal::recordTransform(int firstFrame, int lastFrame, const FrameTransform& transform){
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << qint32(lastFrame) << quint8(transform.getType()) << qint32(transform.getDx()) << qint32(transform.getDy());
+    append(RecordType::TRANSFORM, firstFrame, payload);
+}
+
+void Journal::recordColorReplaced(int firstFrame, int lastFrame, QRgb from, QRgb to, int tolerance){
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << qint32(lastFrame) << quint32(from) << quint32(to) << qint32(tolerance);
+    append(RecordType::REPLACE_COLOR, firstFrame, payload);
+}
+
+void Journal::recordChange(const History::Change& change, Sprite& sprite){
+    switch (change.type) {
+    case History::ChangeType::PIXELS:
+        if (file.isOpen() && !change.tiles.isEmpty()) {
+            const Frame pixels = sprite.getLayer(change.frameIndex, change.layerIndex).pixels;
+            append(RecordType::PIXELS, change.frameIndex, packTiles(change.layerIndex, pixels, change.tiles));
+        }
+        break;
+    case History::ChangeType::ADD_FRAME:
+        recordFrameAdded();
+        break;
+    case History::ChangeType::INSERT_FRAME:
+        // Restoring a deleted frame with layers is rare, so it starts a new snapshot rather than a record of them
+        if (!sprite.getLayers(change.frameIndex).isEmpty()) {
+            if (file.isOpen())
+                beginGeneration(sprite);
+            break;
+        }
+        recordFrameInserted(change.frameIndex, sprite.getFrame(change.frameIndex, false));
+        break;
+    case History::ChangeType::DELETE_FRAME:
+        recordFrameDeleted(change.frameIndex);
+        break;
+    case History::ChangeType::DUPLICATE_FRAME:
+        recordFrameDuplicated(change.frameIndex);
+        break;
+    case History::ChangeType::ADD_LAYER:
+        recordLayerAdded(change.frameIndex, change.layerIndex);
+        break;
+    case History::ChangeType::INSERT_LAYER:
+        // As is restoring a deleted layer
+        if (file.isOpen())
+            beginGeneration(sprite);
+        break;
+    case History::ChangeType::DELETE_LAYER:
+        recordLayerDeleted(change.frameIndex, change.layerIndex);
+        break;
+    case History::ChangeType::SET_LAYER:
+        recordLayerChanged(change.frameIndex, change.layerIndex, sprite.getLayer(change.frameIndex, change.layerIndex));
+        break;
+    case History::ChangeType::TRANSFORM:
+        recordTransform(change.frameIndex, change.lastFrameIndex, change.transform);
+        break;
+    case History::ChangeType::PIXEL_BATCH:
+        for (const History::Change& part : change.parts)
+            recordChange(part, sprite);
+        break;
+    case History::ChangeType::SET_PALETTE:
+        for (int index : change.paletteIndices)
+            recordPaletteColor(index, change.color);
+        break;
+    }
+}
+
+bool Journal::replay(Sprite& sprite, QIODevice& device, int generation){
+    QDataStream stream(&device);
+    quint32 magic;
+    qint32 fileGeneration;
+    stream >> magic >> fileGeneration;
+    if (stream.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || fileGeneration != generation)
+        return false;
+
+    while (!stream.atEnd()) {
+        quint8 type;
+        qint32 frameIndex;
+        quint32 size;
+        stream >> type >> frameIndex >> size;
+        if (stream.status() != QDataStream::Ok || size > device.bytesAvailable())
+            return false;
+        QByteArray payload(size, Qt::Uninitialized);
+        if (stream.readRawData(payload.data(), size) != int(size))
+            return false;
+        if (!apply(sprite, RecordType(type), frameIndex, payload))
+            return false;
+    }
+    return true;
+}
+
+bool Journal::apply(Sprite& sprite, RecordType type, int frameIndex, const QByteArray& payload){
+    const int frameCount = sprite.getFrameCount();
+    switch (type) {
+    case RecordType::PIXELS: {
+        if (frameIndex < 0 || frameIndex >= frameCount)
+            return false;
+
+        QDataStream stream(payload);
+        qint32 layerIndex, tileCount;
+        stream >> layerIndex >> tileCount;
+        if (stream.status() != QDataStream::Ok || layerIndex < 0 || layerIndex >= sprite.getLayerCount(frameIndex))
+            return false;
+        Frame& frame = sprite.getLayerPixels(frameIndex, layerIndex);
+        if (tileCount < 0 || tileCount > frame.getTileColumns() * frame.getTileRows())
+            return false;
+        QVector<QRect> tiles;
+        qsizetype pixelCount = 0;
+        for (int i = 0; i < tileCount; i++) {
+            qint32 x, y;
+            stream >> x >> y;
+            if (stream.status() != QDataStream::Ok || !frame.getRect().contains(x, y))
+                return false;
+            tiles.append(frame.tileRect(x / Frame::TILE_SIZE, y / Frame::TILE_SIZE));
+            pixelCount += qsizetype(tiles.last().width()) * tiles.last().height();
+        }
+
+        QByteArray raw = qUncompress(payload.mid(stream.device()->pos()));
+        if (raw.size() != pixelCount * qsizetype(sizeof(QRgb)))
+            return false;
+        QRgb* pixels = reinterpret_cast<QRgb*>(raw.data());
+        qFromLittleEndian<quint32>(pixels, pixelCount, pixels);
+        QRect written;
+        for (const QRect& tile : tiles) {
+            frame.writeRect(tile, pixels);
+            pixels += tile.width() * tile.height();
+            written |= tile;
+        }
+        sprite.layerEdited(frameIndex, layerIndex, written);
+        return true;
+    }
+    case RecordType::ADD_FRAME:
+        sprite.addFrame();
+        return true;
+    case RecordType::INSERT_FRAME: {
+        if (frameIndex < 0 || frameIndex > frameCount)
+            return false;
+        QByteArray raw = qUncompress(payload);
+        const qsizetype pixelCount = qsizetype(sprite.getWidth()) * sprite.getHeight();
+        if (raw.size() != pixelCount * qsizetype(sizeof(QRgb)))
+            return false;
+        QRgb* pixels = reinterpret_cast<QRgb*>(raw.data());
+        qFromLittleEndian<quint32>(pixels, pixelCount, pixels);
+        Frame frame(sprite.getWidth(), sprite.getHeight());
+        frame.writeRect(frame.getRect(), pixels);
+        sprite.insertFrame(frameIndex, frame);
+        return true;
+    }
+    case RecordType::DELETE_FRAME:
+        if (frameIndex < 0 || frameIndex >= frameCount || frameCount <= 1)
+            return false;
+        sprite.deleteFrame(frameIndex);
+        return true;
+    case RecordType::DUPLICATE_FRAME:
+        if (frameIndex < 0 || frameIndex >= frameCount)
+            return false;
+        sprite.duplicateFrame(frameIndex);
+        return true;
+    case RecordType::SET_PALETTE_COLOR: {
+        if (!sprite.isIndexed() || frameIndex < 0 || frameIndex >= sprite.getPalette().size())
+            return false;
+        QDataStream stream(payload);
+        quint32 color;
+        stream >> color;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        sprite.setPaletteColor(frameIndex, color);
+        return true;
+    }
+    case RecordType::ADD_LAYER:
+    case RecordType::DELETE_LAYER:
+    case RecordType::SET_LAYER: {
+        if (frameIndex < 0 || frameIndex >= frameCount)
+            return false;
+        QDataStream stream(payload);
+        qint32 layerIndex;
+        stream >> layerIndex;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        const int layerCount = sprite.getLayerCount(frameIndex);
+
+        if (type == RecordType::ADD_LAYER)
+            return layerIndex >= 0 && layerIndex <= layerCount && sprite.addLayer(frameIndex, layerIndex);
+        if (layerIndex < 0 || layerIndex >= layerCount)
+            return false;
+        if (type == RecordType::DELETE_LAYER) {
+            if (layerCount <= 1)
+                return false;
+            sprite.deleteLayer(frameIndex, layerIndex);
+            return true;
+        }
+
+        quint8 visible, opacity, mode;
+        stream >> visible >> opacity >> mode;
+        if (stream.status() != QDataStream::Ok || mode > quint8(BlendMode::REPLACE))
+            return false;
+        sprite.setLayerProperties(frameIndex, layerIndex, visible, opacity, BlendMode(mode));
+        return true;
+    }
+    case RecordType::TRANSFORM: {
+        QDataStream stream(payload);
+        qint32 lastFrame, dx, dy;
+        quint8 transformType;
+        stream >> lastFrame >> transformType >> dx >> dy;
+        if (stream.status() != QDataStream::Ok || frameIndex < 0 || lastFrame < frameIndex || lastFrame >= frameCount
+            || transformType > quint8(TransformType::INVERT_COLORS))
+            return false;
+        return sprite.transformFrames(frameIndex, lastFrame, FrameTransform(TransformType(transformType), dx, dy));
+    }
+    case RecordType::REPLACE_COLOR: {
+        QDataStream stream(payload);
+        qint32 lastFrame, tolerance;
+        quint32 from, to;
+        stream >> lastFrame >> from >> to >> tolerance;
+        if (stream.status() != QDataStream::Ok || frameIndex < 0 || lastFrame < frameIndex || lastFrame >= frameCount
+            || tolerance < 0 || tolerance > 255)
+            return false;
+        sprite.replaceColor(frameIndex, lastFrame, from, to, tolerance);
+        return true;
+    }
+    }
+    return false;
+}
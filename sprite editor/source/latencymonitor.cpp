@@ -0,0 +1,81 @@
+/**
+ * Records how long each stage between a mouse event and the canvas being repainted takes, along with how
+ * long each animation tick takes, and summarizes them as percentiles. Only the most recent samples of each
+ * stage are kept, so recording costs the same however long the editor runs.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "latencymonitor.h"
+#include <algorithm>
+
+LatencyMonitor::LatencyMonitor(){
+    clock.start();
+}
+
+qint64 LatencyMonitor::now() const{
+    return clock.nsecsElapsed();
+}
+
+void LatencyMonitor::record(Stage stage, qint64 nanoseconds){
+    Samples& samples = stages[stage];
+    if (samples.values.size() < CAPACITY) {
+        samples.values.append(nanoseconds);
+        return;
+    }
+    samples.values[samples.next] = nanoseconds;
+    samples.next = (samples.next + 1) % CAPACITY;
+}
+
+void LatencyMonitor::recordSince(Stage stage, qint64 start){
+    record(stage, now() - start);
+}
+
+LatencyMonitor::Summary LatencyMonitor::summarize(Stage stage) const{
+    QVector<qint64> sorted = stages[stage].values;
+    Summary summary;
+    summary.samples = sorted.size();
+    if (sorted.isEmpty())
+        return summary;
+
+    std::sort(sorted.begin(), sorted.end());
+    const auto percentile = [&sorted](int percent) {
+        return sorted.at((sorted.size() - 1) * percent / 100) / 1e6;
+    };
+    summary.p50 = percentile(50);
+    summary.p95 = percentile(95);
+    summary.p99 = percentile(99);
+    summary.max = sorted.last() / 1e6;
+    return summary;
+}
+
+QStringList LatencyMonitor::report() const{
+    QStringList lines;
+    lines.append(QString("%1 %2 %3 %4 %5 (ms)").arg("", -9).arg("p50", 7).arg("p95", 7).arg("p99", 7).arg("max", 7));
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Summary summary = summarize(Stage(stage));
+        lines.append(QString("%1 %2 %3 %4 %5  n=%6").arg(stageName(Stage(stage)), -9)
+                         .arg(summary.p50, 7, 'f', 2).arg(summary.p95, 7, 'f', 2)
+                         .arg(summary.p99, 7, 'f', 2).arg(summary.max, 7, 'f', 2)
+                         .arg(summary.samples));
+    }
+    return lines;
+}
+
+void LatencyMonitor::clear(){
+    for (Samples& samples : stages)
+        samples = Samples();
+}
+
+QString LatencyMonitor::stageName(Stage stage){
+    switch (stage) {
+    case INPUT: return "input";
+    case EDIT: return "edit";
+    case RENDER: return "render";
+    case PRESENT: return "present";
+    case TOTAL: return "total";
+    case ANIMATION: return "animation";
+    default: return "";
+    }
+}
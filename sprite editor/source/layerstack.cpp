@@ -0,0 +1,139 @@
+/**
+ * The layers of one frame, bottom first, each with its own visibility, opacity and blend mode. The stack
+ * flattens its layers into the frame the rest of the editor shows and saves. While one layer is being
+ * drawn on, the layers below it and the layers above it are each kept composited, so an edit only has to
+ * composite the edited layer between the two and costs the same however many layers the frame has.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "layerstack.h"
+
+bool Layer::isPlain() const{
+    return visible && opacity == 255 && mode == BlendMode::SOURCE_OVER;
+}
+
+LayerStack::LayerStack(const QVector<Layer>& layers) : layers{layers} {}
+
+bool LayerStack::isEmpty() const{
+    return layers.isEmpty();
+}
+
+int LayerStack::count() const{
+    return layers.size();
+}
+
+const Layer& LayerStack::at(int index) const{
+    return layers.at(index);
+}
+
+const QVector<Layer>& LayerStack::getLayers() const{
+    return layers;
+}
+
+Frame& LayerStack::pixels(int index){
+    // The composites around the cached layer hold every other layer as it is now
+    if (index != cachedLayer)
+        dropCache();
+    return layers[index].pixels;
+}
+
+void LayerStack::insert(int index, const Layer& layer){
+    layers.insert(index, layer);
+    dropCache();
+}
+
+void LayerStack::remove(int index){
+    layers.remove(index);
+    dropCache();
+}
+
+void LayerStack::setProperties(int index, bool visible, quint8 opacity, BlendMode mode){
+    Layer& layer = layers[index];
+    layer.visible = visible;
+    layer.opacity = opacity;
+    layer.mode = mode;
+    dropCache();
+}
+
+void LayerStack::dropCache(){
+    cachedLayer = -1;
+    below = Frame();
+    above = Frame();
+    aboveCached = false;
+}
+
+void LayerStack::compose(QVector<QRgb>& line, int first, int last, int x, int y, QVector<QRgb>& pixels) const{
+    for (int i = first; i <= last; i++) {
+        const Layer& layer = layers.at(i);
+        if (!layer.visible || layer.opacity == 0)
+            continue;
+        layer.pixels.readRow(x, y, line.size(), pixels.data());
+        Blend::blendLayer(line.data(), pixels.constData(), line.size(), layer.opacity, layer.mode);
+    }
+}
+
+void LayerStack::cache(int layer){
+    dropCache();
+    const int width = layers.at(layer).pixels.getWidth();
+    const int height = layers.at(layer).pixels.getHeight();
+    cachedLayer = layer;
+
+    // Source over is the only mode whose result does not depend on what is underneath, so the layers above
+    // can only be composited ahead of the edited layer if every visible one uses it
+    aboveCached = true;
+    for (int i = layer + 1; i < count(); i++) {
+        if (layers.at(i).visible && layers.at(i).mode != BlendMode::SOURCE_OVER)
+            aboveCached = false;
+    }
+
+    below = Frame(width, height);
+    if (aboveCached)
+        above = Frame(width, height);
+    QVector<QRgb> line(width);
+    QVector<QRgb> pixels(width);
+    for (int y = 0; y < height; y++) {
+        if (layer > 0) {
+            line.fill(0);
+            compose(line, 0, layer - 1, 0, y, pixels);
+            below.writeRow(0, y, width, line.constData());
+        }
+        if (aboveCached && layer < count() - 1) {
+            line.fill(0);
+            compose(line, layer + 1, count() - 1, 0, y, pixels);
+            above.writeRow(0, y, width, line.constData());
+        }
+    }
+}
+
+void LayerStack::flatten(Frame& flattened, QRect rect, int editedLayer){
+    rect &= flattened.getRect();
+    if (rect.isEmpty())
+        return;
+    if (editedLayer >= 0 && editedLayer != cachedLayer)
+        cache(editedLayer);
+
+    QVector<QRgb> line(rect.width());
+    QVector<QRgb> pixels(rect.width());
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        if (editedLayer < 0) {
+            line.fill(0);
+            compose(line, 0, count() - 1, rect.left(), y, pixels);
+        } else {
+            below.readRow(rect.left(), y, rect.width(), line.data());
+            compose(line, editedLayer, editedLayer, rect.left(), y, pixels);
+            if (aboveCached) {
+                above.readRow(rect.left(), y, rect.width(), pixels.data());
+                for (int x = 0; x < rect.width(); x++)
+                    line[x] = Blend::over(pixels[x], line[x]);
+            } else {
+                compose(line, editedLayer + 1, count() - 1, rect.left(), y, pixels);
+            }
+        }
+
+        for (QRgb& pixel : line)
+            pixel = qUnpremultiply(pixel);
+        flattened.writeRow(rect.left(), y, rect.width(), line.constData());
+    }
+}
@@ -0,0 +1,266 @@
+/**
+ * Streaming reader for legacy JSON .ssp projects. The legacy format is an array of frames, each frame an
+ * array of {"red", "green", "blue", "alpha"} objects in column major order. The reader tokenizes the file
+ * in small chunks and decodes one frame at a time straight into QImage scanlines, so the JSON document is
+ * never held in memory as a whole.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "legacyprojectreader.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+LegacyProjectReader::LegacyProjectReader(QIODevice& device) : device{device} {
+    bufferStart = device.pos();
+}
+
+bool LegacyProjectReader::refill(){
+    bufferStart += buffer.size();
+    buffer = device.read(CHUNK_SIZE);
+    bufferPos = 0;
+    return !buffer.isEmpty();
+}
+
+bool LegacyProjectReader::peek(char& c){
+    if (bufferPos >= buffer.size() && !refill())
+        return false;
+    c = buffer.at(bufferPos);
+    return true;
+}
+
+void LegacyProjectReader::skipWhitespace(){
+    char c;
+    while (peek(c) && (c == ' ' || c == '\n' || c == '\r' || c == '\t'))
+        bufferPos++;
+}
+
+bool LegacyProjectReader::expect(char expected){
+    skipWhitespace();
+    char c;
+    if (!peek(c))
+        return fail(QString("Unexpected end of file, expected '%1'").arg(QChar(expected)));
+    if (c != expected)
+        return fail(QString("Found '%1', expected '%2'").arg(QChar(c)).arg(QChar(expected)));
+    bufferPos++;
+    return true;
+}
+
+bool LegacyProjectReader::fail(const QString& message){
+    if (error.isEmpty())
+        error = QString("%1 (at byte %2)").arg(message).arg(position());
+    return false;
+}
+
+qint64 LegacyProjectReader::position() const{
+    return bufferStart + bufferPos;
+}
+
+bool LegacyProjectReader::readChannel(int& value){
+    skipWhitespace();
+    value = 0;
+    int digits = 0;
+    char c;
+    while (peek(c) && c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        if (++digits > 3)
+            return fail("Color value is out of range");
+        bufferPos++;
+    }
+    if (digits == 0)
+        return fail("Expected a color value");
+    if (value > 255)
+        return fail(QString("Color value %1 is out of range").arg(value));
+    return true;
+}
+
+bool LegacyProjectReader::readPixel(QRgb& pixel){
+    static const char* const channelNames[4] = {"red", "green", "blue", "alpha"};
+    int channels[4] = {-1, -1, -1, -1};
+
+    if (!expect('{'))
+        return false;
+
+    for (int field = 0; field < 4; field++) {
+        if (field > 0 && !expect(','))
+            return false;
+        if (!expect('"'))
+            return false;
+
+        // Keys are short, so read them into a fixed buffer rather than allocating
+        char key[8];
+        int keyLength = 0;
+        char c;
+        while (true) {
+            if (!peek(c))
+                return fail("Unexpected end of file in a key");
+            bufferPos++;
+            if (c == '"')
+                break;
+            if (keyLength == int(sizeof(key)) - 1)
+                return fail("Unknown color key");
+            key[keyLength++] = c;
+        }
+        key[keyLength] = '\0';
+
+        int channel = 0;
+        while (channel < 4 && std::strcmp(key, channelNames[channel]) != 0)
+            channel++;
+        if (channel == 4)
+            return fail(QString("Unknown color key \"%1\"").arg(QString(key)));
+        if (channels[channel] != -1)
+            return fail(QString("Duplicate color key \"%1\"").arg(QString(key)));
+
+        if (!expect(':') || !readChannel(channels[channel]))
+            return false;
+    }
+
+    if (!expect('}'))
+        return false;
+
+    pixel = qRgba(channels[0], channels[1], channels[2], channels[3]);
+    return true;
+}
+
+bool LegacyProjectReader::countFirstFrame(int& pixelCount){
+    if (device.isSequential())
+        return fail("Legacy projects can only be imported from a seekable device");
+
+    const qint64 framePos = position();
+    pixelCount = 0;
+    int depth = 0;
+    bool inString = false;
+    char c;
+    do {
+        if (!peek(c))
+            return fail("Unexpected end of file in the first frame");
+        bufferPos++;
+
+        if (inString) {
+            char escaped;
+            if (c == '\\' && peek(escaped))
+                bufferPos++;
+            else if (c == '"')
+                inString = false;
+            continue;
+        }
+        switch (c) {
+        case '"':
+            inString = true;
+            break;
+        case '[':
+            depth++;
+            break;
+        case ']':
+            depth--;
+            break;
+        case '{':
+            if (depth == 1)
+                pixelCount++;
+            break;
+        }
+    } while (depth > 0);
+
+    // Rewind so the frame can be decoded now that its size is known
+    if (!device.seek(framePos))
+        return fail("Could not rewind to the first frame");
+    buffer.clear();
+    bufferPos = 0;
+    bufferStart = framePos;
+    return true;
+}
+
+bool LegacyProjectReader::readHeader(){
+    if (!expect('['))
+        return false;
+
+    skipWhitespace();
+    char c;
+    if (!peek(c) || c != '[')
+        return fail("The project has no frames");
+
+    int pixelCount;
+    if (!countFirstFrame(pixelCount))
+        return false;
+
+    width = int(std::lround(std::sqrt(double(pixelCount))));
+    if (pixelCount == 0 || width * width != pixelCount)
+        return fail(QString("The first frame has %1 pixels, which is not a square sprite").arg(pixelCount));
+
+    return true;
+}
+
+bool LegacyProjectReader::readFrame(QImage& image){
+    if (finished || hasError() || width == 0)
+        return false;
+
+    // Frames after the first are separated by commas, and the project ends with a ']'
+    if (framesRead > 0) {
+        skipWhitespace();
+        char c;
+        if (!peek(c))
+            return fail("Unexpected end of file between frames");
+        if (c == ']') {
+            bufferPos++;
+            finished = true;
+            return false;
+        }
+        if (!expect(','))
+            return false;
+    }
+
+    if (!expect('['))
+        return false;
+
+    image = QImage(width, width, QImage::Format_ARGB32);
+    std::vector<QRgb*> rows(width);
+    for (int y = 0; y < width; y++)
+        rows[y] = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+    const int pixelCount = width * width;
+    for (int i = 0; i < pixelCount; i++) {
+        skipWhitespace();
+        char c;
+        if (peek(c) && c == ']')
+            return fail(QString("Frame %1 has %2 pixels, expected %3").arg(framesRead + 1).arg(i).arg(pixelCount));
+        if (i > 0 && !expect(','))
+            return false;
+
+        // Legacy frames are stored column by column
+        QRgb pixel;
+        if (!readPixel(pixel))
+            return false;
+        rows[i % width][i / width] = pixel;
+    }
+
+    skipWhitespace();
+    char c;
+    if (peek(c) && c == ',')
+        return fail(QString("Frame %1 has more than %2 pixels").arg(framesRead + 1).arg(pixelCount));
+    if (!expect(']'))
+        return false;
+
+    framesRead++;
+    return true;
+}
+
+int LegacyProjectReader::getWidth() const{
+    return width;
+}
+
+int LegacyProjectReader::progress() const{
+    const qint64 total = device.size();
+    if (total <= 0)
+        return 0;
+    return int(qMin<qint64>(100, position() * 100 / total));
+}
+
+bool LegacyProjectReader::hasError() const{
+    return !error.isEmpty();
+}
+
+QString LegacyProjectReader::errorString() const{
+    return error;
+}
@@ -6,6 +6,7 @@
 int main(int argc, char *argv[]){
     QCoreApplication::setAttribute(Qt::AA_DontUseNativeMenuBar);
     QApplication a(argc, argv);
+    QCoreApplication::setApplicationName("A8SpriteEditor"); // Names the folder crash recovery is kept in
     Model m;
     MainWindow w(&m);
     w.setWindowTitle("Sprite Editor");
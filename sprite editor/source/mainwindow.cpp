@@ -1,6 +1,6 @@
 /**
  * Represent the view of the sprite editor. Connects all of the slots and signals between the model and the view.
- * Sets the icons for each button and creates a new button for each new frome that is made. Handles the clicking of
+ * Sets the icons for each button and keeps the frame strip in step with the sprite's frames. Handles the clicking of
  * buttons and sends signals to the model to handle the clicks.
  *
  * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
@@ -15,17 +15,19 @@
 #include <QPainter>
 #include <QColorDialog>
 #include <QPixmap>
-#include <QVBoxLayout>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QTimer>
 
 
 MainWindow::MainWindow(Model* model, QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow), model(model) {
     ui->setupUi(this);
 
-    // Creates a container for all of the frame buttons.
-    contentLayout = new QVBoxLayout(ui->frames);
-    contentLayout->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    // The frame strip only creates the items which are on screen, with thumbnails made on a worker thread.
+    frameList = new FrameListModel(this);
+    ui->frameStrip->setModel(frameList);
 
     // Sets the initial value of the slider and displays the text.
     ui->fpsSlider->setValue(animationFPS);
@@ -60,12 +62,23 @@ MainWindow::MainWindow(Model* model, QWidget *parent) : QMainWindow(parent), ui(
     connect(&newFile, &NewFile::sendSize, this, &MainWindow::setupNewView);
     connect(this, &MainWindow::setupModel, model, &Model::setupSprite);
     connect(model, &Model::loadedProject, this, &MainWindow::setupLoadView);
+    connect(model, &Model::loadProgress, this, &MainWindow::showLoadProgress);
 
     // Canvas connections
     connect(ui->canvas, &CanvasLabel::draw, this, &MainWindow::canvasInput);    // Get canvas-relative input from the canvas
-    connect(this, &MainWindow::sendPixelInput, model, &Model::editImage);       // Send sprite-relative input to model
+    connect(this, &MainWindow::sendPixelInput, model, &Model::editStroke);      // Send sprite-relative input to model
     connect(model, &Model::canvasDraw, this, &MainWindow::canvasDraw);          // Recieve the sprite image to draw
+    connect(model, &Model::onionSkinChanged, ui->canvas, &CanvasLabel::setOnionSkin);
+    connect(ui->canvas, &CanvasLabel::strokeFinished, model, &Model::endStroke);
+    connect(ui->canvas, &CanvasLabel::viewportChanged, model, &Model::redrawCanvas);
     connect(model, &Model::animated, this, &MainWindow::animationDraw);
+    connect(this, &MainWindow::previewRequested, model, &Model::requestPreview);
+    connect(model, &Model::previewReady, this, &MainWindow::cachePreview);
+    connect(model, &Model::previewsInvalidated, this, &MainWindow::invalidatePreviews);
+    connect(model, &Model::previewsInvalidated, frameList, &FrameListModel::invalidate);
+    connect(frameList, &FrameListModel::thumbnailRequested, model, &Model::requestThumbnail);
+    connect(model, &Model::thumbnailReady, frameList, &FrameListModel::setThumbnail);
+    connect(ui->frameStrip, &QListView::clicked, this, &MainWindow::frameClicked);
 
     // Button connections
     connect(ui->drawButton, &QPushButton::clicked, this, &MainWindow::brushButtonClicked);
@@ -82,8 +95,38 @@ MainWindow::MainWindow(Model* model, QWidget *parent) : QMainWindow(parent), ui(
     connect(ui->newAction, &QAction::triggered, this, &MainWindow::newFileOpened);
     connect(ui->saveAction, &QAction::triggered, this, &MainWindow::saveButtonClicked);
     connect(ui->loadAction, &QAction::triggered, this, &MainWindow::loadButtonClicked);
+    connect(ui->undoAction, &QAction::triggered, model, &Model::undo);
+    connect(ui->redoAction, &QAction::triggered, model, &Model::redo);
+    connect(model, &Model::historyChanged, this, &MainWindow::updateHistoryActions);
+    connect(model, &Model::framesChanged, this, &MainWindow::syncFrames);
     connect(this, &MainWindow::saveFile, model, &Model::Serialize);
+    connect(model, &Model::saveFinished, this, &MainWindow::showSaveResult);
     connect(this, &MainWindow::loadFile, model, &Model::Deserialize);
+    connect(this, &MainWindow::recoverProject, model, &Model::recover);
+    connect(ui->indexedColorAction, &QAction::toggled, this, &MainWindow::indexedColorToggled);
+    connect(ui->recolorPaletteAction, &QAction::triggered, this, &MainWindow::recolorPaletteClicked);
+    connect(this, &MainWindow::indexedModeRequested, model, &Model::setIndexedMode);
+    connect(this, &MainWindow::paletteColorReplaced, model, &Model::replacePaletteColor);
+    connect(model, &Model::indexedModeChanged, this, &MainWindow::updateIndexedMode);
+    connect(model, &Model::indexedModeFailed, this, &MainWindow::showIndexedModeError);
+    connect(this, &MainWindow::transformRequested, model, &Model::transformFrames);
+    const QVector<std::pair<QAction*, TransformType>> transformActions = {
+        {ui->flipHorizontalAction, TransformType::FLIP_HORIZONTAL},
+        {ui->flipVerticalAction, TransformType::FLIP_VERTICAL},
+        {ui->rotateClockwiseAction, TransformType::ROTATE_CLOCKWISE},
+        {ui->rotateCounterclockwiseAction, TransformType::ROTATE_COUNTERCLOCKWISE},
+        {ui->rotateHalfAction, TransformType::ROTATE_HALF},
+        {ui->invertColorsAction, TransformType::INVERT_COLORS},
+    };
+    for (const auto& [action, type] : transformActions) {
+        const TransformType transformType = type;
+        connect(action, &QAction::triggered, this, [this, transformType]() {
+            requestTransform(FrameTransform(transformType));
+        });
+    }
+    connect(ui->shiftAction, &QAction::triggered, this, &MainWindow::shiftClicked);
+    connect(ui->replaceColorAction, &QAction::triggered, this, &MainWindow::replaceColorClicked);
+    connect(this, &MainWindow::colorReplaceRequested, model, &Model::replaceColor);
 
     // Button Action connections
     connect(this, &MainWindow::toolChanged, model, &Model::changeTool);
@@ -93,9 +136,40 @@ MainWindow::MainWindow(Model* model, QWidget *parent) : QMainWindow(parent), ui(
     connect(model, &Model::updateColor, this, &MainWindow::updatedColor);
     connect(this, &MainWindow::changeFrame, model, &Model::setSpriteFrame);
     connect(this, &MainWindow::duplicateFrame, model, &Model::duplicateSpriteFrame);
+    connect(ui->fillTolerance, &QSpinBox::valueChanged, model, &Model::changeFillTolerance);
+    connect(ui->blendMode, &QComboBox::currentIndexChanged, model, [model](int index) {
+        model->changeBlendMode(BlendMode(index));
+    });
+    connect(ui->onionSkinRange, &QSpinBox::valueChanged, model, &Model::changeOnionSkinRange);
+    connect(ui->brushSize, &QSpinBox::valueChanged, model, &Model::changeBrushSize);
+    connect(ui->brushShape, &QComboBox::currentIndexChanged, model, [model](int index) {
+        model->changeBrushShape(BrushShape(index));
+    });
+    connect(ui->fillDiagonally, &QCheckBox::toggled, model, [model](bool diagonal) {
+        model->changeFillConnectivity(diagonal ? Connectivity::EIGHT : Connectivity::FOUR);
+    });
+
+    // Layer connections
+    connect(ui->addLayer, &QPushButton::clicked, model, &Model::addLayer);
+    connect(ui->deleteLayer, &QPushButton::clicked, model, &Model::deleteLayer);
+    connect(ui->layerIndex, &QSpinBox::valueChanged, model, [model](int layer) {
+        model->selectLayer(layer - 1);
+    });
+    connect(ui->layerVisible, &QCheckBox::toggled, model, &Model::setLayerVisible);
+    connect(ui->layerOpacity, &QSpinBox::valueChanged, model, &Model::setLayerOpacity);
+    connect(ui->layerBlendMode, &QComboBox::currentIndexChanged, model, [model](int index) {
+        model->setLayerBlendMode(BlendMode(index));
+    });
+    connect(model, &Model::layersChanged, this, &MainWindow::updateLayers);
 
     // Animation connections
-    connect(animationTimer, &QTimer::timeout, model, &Model::animateNextFrame);
+    connect(animationTimer, &QTimer::timeout, this, &MainWindow::animationTimerFired);
+    connect(this, &MainWindow::animationTick, model, &Model::animateNextFrame);
+
+    // Latency instrumentation connections
+    ui->canvas->setLatencyMonitor(&latency);
+    connect(ui->latencyOverlayAction, &QAction::toggled, ui->canvas, &CanvasLabel::setLatencyOverlayVisible);
+    connect(ui->logLatencyAction, &QAction::triggered, this, &MainWindow::logLatency);
 
 
     //Setting initial color to black
@@ -107,6 +181,8 @@ MainWindow::MainWindow(Model* model, QWidget *parent) : QMainWindow(parent), ui(
         .arg(currentColor.alpha());
     ui->colorPicker->setStyleSheet(styleSheet);
 
+    // Ask about crash recovery once the window is showing
+    QTimer::singleShot(0, this, &MainWindow::offerRecovery);
 }
 
 MainWindow::~MainWindow()
@@ -115,115 +191,86 @@ MainWindow::~MainWindow()
     delete animationTimer;
 }
 
-void MainWindow::setupNewView(int spriteSize){
-    setupView(spriteSize);
+void MainWindow::setupNewView(int width, int height){
+    setupView(width, height);
 
     // Send sprite size info to Model for sprite setup
-    emit setupModel(spriteSize);
-
-    //Setting up the scroll view and adding the first button.
-    QPushButton *button = new QPushButton("Frame 1", nullptr);
-    framesVector.append(button);
-    button->setProperty("buttonID", framesVector.size()); //sets the id of the button
-    contentLayout->addWidget(button); // adds the button to a group
-    ui->scrollArea->setWidget(ui->frames); // put the buttons into the scroll view.
-
-    // Connect the new button's click signal to a lambda that identifies which button is clicked
-    connect(button, &QPushButton::clicked, [this, button]() {
-        currentFrame = button->property("buttonID").toInt();
-        this->ui->mainFrameNum->setText("Frame " + QString::number(currentFrame));
-
-        // sends a signal to the model to tell it which frame to show.
-        emit changeFrame(currentFrame);
-    });
+    emit setupModel(width, height);
+
+    //Setting up the frame strip with the first frame.
+    frameList->setFrameCount(1);
+    showCurrentFrame(1);
 
     animationTimer->start();
 }
 
-void MainWindow::setupLoadView(int spriteSize, int frameCount){
-    setupView(spriteSize);
+void MainWindow::setupLoadView(int width, int height, int frameCount){
+    setupView(width, height);
 
-    //Create buttons for all of the loaded frames.
-    for (int i = 0; i < frameCount; ++i) {
-        QPushButton *button = new QPushButton("Frame " + QString::number(i + 1), nullptr);
-        framesVector.append(button);
-        button->setProperty("buttonID", framesVector.size()); //sets the id of the button
-        contentLayout->addWidget(button); // adds the button to a group
-        ui->scrollArea->setWidget(ui->frames); // put the buttons into the scroll view.
+    //Show all of the loaded frames.
+    frameList->setFrameCount(frameCount);
+    showCurrentFrame(1);
+    ui->removeFrame->setEnabled(frameCount > 1);
 
-        // Connect the new button's click signal to a lambda that identifies which button is clicked
-        connect(button, &QPushButton::clicked, [this, button]() {
-            currentFrame = button->property("buttonID").toInt();
-            this->ui->mainFrameNum->setText("Frame " + QString::number(currentFrame));
+    animationTimer->start();
+}
 
-            // sends a signal to the model to tell it which frame to show.
-            emit changeFrame(currentFrame);
-        });
-    }
+void MainWindow::showCurrentFrame(int frameID){
+    currentFrame = frameID;
+    ui->mainFrameNum->setText("Frame " + QString::number(currentFrame));
+    ui->frameStrip->setCurrentIndex(frameList->index(currentFrame - 1));
+}
 
-    animationTimer->start();
+void MainWindow::frameClicked(const QModelIndex& index){
+    showCurrentFrame(index.row() + 1);
+
+    // sends a signal to the model to tell it which frame to show.
+    emit changeFrame(currentFrame);
 }
 
-void MainWindow::setupView(int spriteSize){
+void MainWindow::setupView(int width, int height){
 
     animationTimer->stop();
     currentFrame = 1;
 
-    this->spriteSize = spriteSize;
+    spriteSize = QSize(width, height);
 
     // Delete any old data
-    while (QLayoutItem* item = contentLayout->takeAt(0)) {
-        if (QWidget* widget = item->widget()) {
-            widget->deleteLater();
-        }
-        delete item;
-    }
-    framesVector.clear();
-
-    // Setup canvas checker background
-    int checkerSize = 1;
-    QColor checkerColor1(200,200,200);
-    QColor checkerColor2(150,150,150);
-
-    // Create 2x2 checker pixmap pattern
-    QPixmap checkerMap(checkerSize*2, checkerSize*2);
-    QPainter painter(&checkerMap);
-    painter.fillRect(0, 0, checkerSize, checkerSize, checkerColor1);
-    painter.fillRect(checkerSize, 0, checkerSize, checkerSize, checkerColor2);
-    painter.fillRect(0, checkerSize, checkerSize, checkerSize, checkerColor2);
-    painter.fillRect(checkerSize, checkerSize, checkerSize, checkerSize, checkerColor1);
-    painter.end();
-
-    // Generate full checkerboard pattern
-    QPixmap canvasCheckerboard(spriteSize, spriteSize);
-    QPainter tilePainter(&canvasCheckerboard);
-    for (int x = 0; x < canvasCheckerboard.width(); x += checkerSize * 2) {
-        for (int y = 0; y < canvasCheckerboard.height(); y += checkerSize * 2) {
-            tilePainter.drawPixmap(x, y, checkerMap);
-        }
-    }
-    tilePainter.end();
+    frameList->setFrameCount(0);
 
-    // Apply checkerboard to canvas_background
-    ui->canvas_background->setPixmap(canvasCheckerboard.scaled(ui->canvas_background->width(), ui->canvas_background->height(), Qt::IgnoreAspectRatio, Qt::FastTransformation));
+    // Zoom the canvas to fit, it draws the checkerboard behind the sprite itself
+    ui->canvas->setSpriteSize(spriteSize);
 
     // Enable any buttons which need enabling
     ui->addNewFrame->setEnabled(true);
     ui->duplicateFrame->setEnabled(true);
     ui->removeFrame->setEnabled(false);
+
+    // Every frame has the sprite's size, so only a square sprite can be turned a quarter turn
+    ui->rotateClockwiseAction->setEnabled(width == height);
+    ui->rotateCounterclockwiseAction->setEnabled(width == height);
 }
 
-void MainWindow::canvasInput(QPoint mousePos){
+void MainWindow::canvasInput(const QVector<QPoint>& mousePositions, bool newStroke){
 
     //Check to make sure a sprite is set up
-    if(spriteSize <= 0)
+    if(spriteSize.isEmpty())
         return;
 
-    int pixelX = mousePos.x() * spriteSize / ui->canvas->width();
-    int pixelY = mousePos.y() * spriteSize / ui->canvas->height();
+    QVector<QPoint> pixelPositions;
+    pixelPositions.reserve(mousePositions.size());
+    for (const QPoint& mousePos : mousePositions) {
+        // Several mouse events usually land on the same pixel
+        QPoint pixelPos = ui->canvas->pixelAt(mousePos);
+        if (pixelPositions.isEmpty() || pixelPositions.last() != pixelPos)
+            pixelPositions.append(pixelPos);
+    }
 
-    // Sending relative pixel position.
-    emit sendPixelInput(QPoint(pixelX, pixelY));
+    // Sending relative pixel positions. The model draws the canvas before returning, which is timed separately.
+    const qint64 editStart = latency.now();
+    renderTime = 0;
+    emit sendPixelInput(pixelPositions, newStroke);
+    latency.record(LatencyMonitor::EDIT, latency.now() - editStart - renderTime);
 }
 
 void MainWindow::colorPickerClicked(){
@@ -242,23 +289,42 @@ void MainWindow::colorPickerClicked(){
     }
 }
 
-void MainWindow::canvasDraw(QImage spriteImage){
-
-    QPixmap canvasMap = QPixmap::fromImage(spriteImage).scaled(ui->canvas->width(), ui->canvas->height(), Qt::IgnoreAspectRatio, Qt::FastTransformation);
-
-    // Set the Canvas Label's Pixmap
-    ui->canvas->setPixmap(canvasMap);
+void MainWindow::canvasDraw(const Frame& frame, QRect dirtyRect){
+    // Only the changed cells of the canvas's scaled backing image are repainted
+    const qint64 renderStart = latency.now();
+    ui->canvas->drawFrame(frame, dirtyRect);
+    const qint64 elapsed = latency.now() - renderStart;
+    latency.record(LatencyMonitor::RENDER, elapsed);
+    renderTime += elapsed;
 }
 
-void MainWindow::animationDraw(QImage spriteImage){
+void MainWindow::animationDraw(int frameIndex){
 
-    //Create 2 seperate sized animations (scaled to fit and real size)
-    QPixmap spriteMap = QPixmap::fromImage(spriteImage).scaled(ui->animationView->width(), ui->animationView->height(), Qt::IgnoreAspectRatio, Qt::FastTransformation);
-    QPixmap spriteMapRealSize = QPixmap::fromImage(spriteImage);
+    // Cached pixmaps are made to fit the animation view, so they are dropped if it changes size
+    previewCache.setScaledSize(ui->animationView->size());
+
+    // The model answers the request straight away with previewReady, which caches the frame
+    const PreviewCache::Entry* preview = previewCache.find(frameIndex);
+    if (preview == nullptr) {
+        emit previewRequested(frameIndex);
+        preview = previewCache.find(frameIndex);
+        if (preview == nullptr)
+            return;
+    }
 
     // Set the animation view's Pixmap
-    ui->animationView->setPixmap(spriteMap);
-    ui->trueSizeAnimation->setPixmap(spriteMapRealSize);
+    ui->animationView->setPixmap(preview->scaled);
+    ui->trueSizeAnimation->setPixmap(preview->realSize);
+}
+
+void MainWindow::cachePreview(int frameIndex, const QImage& image){
+    // The cache builds both pixmaps now, one scaled to fit the preview and one at real size, so playing the
+    // animation only has to show them
+    previewCache.insert(frameIndex, image);
+}
+
+void MainWindow::invalidatePreviews(int firstFrame, int lastFrame){
+    previewCache.invalidate(firstFrame, lastFrame);
 }
 
 void MainWindow::eraseButtonClicked(){
@@ -283,22 +349,10 @@ void MainWindow::eyeDropperButtonClicked(){
 
 void MainWindow::newFrameClicked(){
 
-    QPushButton *button = new QPushButton("Frame " + QString::number(framesVector.size() + 1), nullptr);
-    framesVector.append(button);
-    contentLayout->addWidget(button);
-    button->setProperty("buttonID", framesVector.size()); //sets the id of the button
-
-    // Connect the new button's click signal to a lambda that identifies which button is clicked
-    connect(button, &QPushButton::clicked, [this, button]() {
-        currentFrame = button->property("buttonID").toInt();
-        this->ui->mainFrameNum->setText("Frame " + QString::number(currentFrame));
-
-        // sends a signal to the model to tell it which frame to show.
-        emit changeFrame(currentFrame);
-    });
+    frameList->setFrameCount(frameList->getFrameCount() + 1);
 
     // If more than one frames, allow user to remove frames.
-    if(framesVector.size() > 1)
+    if(frameList->getFrameCount() > 1)
         ui->removeFrame->setEnabled(true);
 
     emit newFrameAdded();
@@ -308,23 +362,14 @@ void MainWindow::duplicateFrameClicked()
 {
     int zeroBased=currentFrame-1;
     emit duplicateFrame(zeroBased);
-    if (zeroBased < 0 || zeroBased >= framesVector.size()) {
+    if (zeroBased < 0 || zeroBased >= frameList->getFrameCount()) {
         return;  // do nothing if user tries to duplicate a nonexistent frame
     }
 
-    QPushButton *button = new QPushButton("Frame " + QString::number(framesVector.size()+1), nullptr);
-    framesVector.append(button);
-    contentLayout->addWidget(button);
-    button->setProperty("buttonID", framesVector.size());
-
-    connect(button, &QPushButton::clicked, [this, button]() {
-        currentFrame = button->property("buttonID").toInt();
-        ui->mainFrameNum->setText("Frame " + QString::number(currentFrame));
-        emit changeFrame(currentFrame); // tell Model to switch to that frame
-    });
+    frameList->setFrameCount(frameList->getFrameCount() + 1);
 
     // Optionally re-enable removeFrame if needed
-    if (framesVector.size() > 1)
+    if (frameList->getFrameCount() > 1)
         ui->removeFrame->setEnabled(true);
 }
 
@@ -335,6 +380,8 @@ void MainWindow::newFileOpened(){
 }
 
 void MainWindow::updatedColor(QColor color){
+    // Colors picked with the eyedropper become the current color here, so Replace Color starts from them
+    currentColor = color;
     QString styleSheet = QString("background-color: rgba(%1, %2, %3, %4);")
                              .arg(color.red())
                              .arg(color.green())
@@ -358,29 +405,19 @@ void MainWindow::sliderValueChanged(){
 void MainWindow::removeFrame(){
 
     int zeroBased = currentFrame - 1;
-    if (zeroBased < 0 || zeroBased >= framesVector.size()) {
+    if (zeroBased < 0 || zeroBased >= frameList->getFrameCount()) {
         return; // nothing to remove
     }
 
-    // Remove button from layout.
-    QPushButton *buttonToRemove = framesVector.takeAt(zeroBased);
-    contentLayout->removeWidget(buttonToRemove);
-
     animationTimer->stop();
-    currentFrame = 1;
 
-    emit frameRemoved(buttonToRemove->property("buttonID").toInt() - 1);
-    delete buttonToRemove;
-
-    // Renumber all the remaining buttons
-    for (int i = 0; i < framesVector.size(); ++i) {
-        QPushButton *button = framesVector[i];
-        button->setText("Frame " + QString::number(i + 1)); // Renumbering starts from 1
-        button->setProperty("buttonID", i + 1);
-    }
+    // The strip labels frames by their position, so nothing needs renumbering
+    emit frameRemoved(zeroBased);
+    frameList->setFrameCount(frameList->getFrameCount() - 1);
+    showCurrentFrame(1);
 
     // Don't allow a user to remove a frame when there is only one frame.
-    if(framesVector.size() <= 1)
+    if(frameList->getFrameCount() <= 1)
         ui->removeFrame->setEnabled(false);
 
     animationTimer->start();
@@ -394,6 +431,8 @@ void MainWindow::saveButtonClicked()
 
     QString filePath = fileUrl.toLocalFile();
 
+    // The project saves in the background, so the user can keep drawing meanwhile
+    ui->statusbar->showMessage("Saving project...");
     emit saveFile(filePath);
 }
 
@@ -407,3 +446,133 @@ void MainWindow::loadButtonClicked()
 
     emit loadFile(filePath);
 }
+
+void MainWindow::showLoadProgress(int percent)
+{
+    if (percent >= 100) {
+        ui->statusbar->clearMessage();
+        return;
+    }
+    ui->statusbar->showMessage("Loading project... " + QString::number(percent) + "%");
+
+    // Loading runs on the UI thread, so paint the message straight away
+    ui->statusbar->repaint();
+}
+
+void MainWindow::showSaveResult(const QString& path, const QString& error)
+{
+    if (error.isEmpty()) {
+        ui->statusbar->showMessage("Saved " + QFileInfo(path).fileName(), 3000);
+        return;
+    }
+    ui->statusbar->clearMessage();
+    QMessageBox::warning(this, "Save Project", "Could not save " + path + ":\n" + error);
+}
+
+void MainWindow::offerRecovery()
+{
+    if (!model->hasRecovery())
+        return;
+
+    const QMessageBox::StandardButton answer = QMessageBox::question(this, "Recover Project",
+        "The sprite editor did not close properly last time. Recover the project you were working on?");
+    if (answer == QMessageBox::Yes)
+        emit recoverProject();
+}
+
+void MainWindow::syncFrames(int frameCount, int currentFrameIndex)
+{
+    frameList->setFrameCount(frameCount);
+    ui->removeFrame->setEnabled(frameCount > 1);
+
+    showCurrentFrame(currentFrameIndex + 1);
+}
+
+void MainWindow::updateHistoryActions(bool canUndo, bool canRedo)
+{
+    ui->undoAction->setEnabled(canUndo);
+    ui->redoAction->setEnabled(canRedo);
+}
+
+void MainWindow::animationTimerFired()
+{
+    const qint64 tickStart = latency.now();
+    emit animationTick();
+    latency.recordSince(LatencyMonitor::ANIMATION, tickStart);
+}
+
+void MainWindow::logLatency()
+{
+    for (const QString& line : latency.report())
+        qInfo().noquote() << line;
+}
+
+void MainWindow::indexedColorToggled(bool indexed)
+{
+    emit indexedModeRequested(indexed);
+}
+
+void MainWindow::showIndexedModeError(const QString& reason)
+{
+    QMessageBox::warning(this, "Indexed Color", "The sprite cannot be indexed. " + reason);
+}
+
+void MainWindow::updateIndexedMode(bool indexed)
+{
+    const QSignalBlocker blocker(ui->indexedColorAction);
+    ui->indexedColorAction->setEnabled(true);
+    ui->indexedColorAction->setChecked(indexed);
+    ui->recolorPaletteAction->setEnabled(indexed);
+}
+
+void MainWindow::updateLayers(int layerCount, int currentLayer, bool visible, int opacity, BlendMode mode)
+{
+    // Showing the model's state must not send it back as a change
+    const QSignalBlocker indexBlocker(ui->layerIndex);
+    const QSignalBlocker visibleBlocker(ui->layerVisible);
+    const QSignalBlocker opacityBlocker(ui->layerOpacity);
+    const QSignalBlocker modeBlocker(ui->layerBlendMode);
+    ui->layerIndex->setMaximum(layerCount);
+    ui->layerIndex->setValue(currentLayer + 1);
+    ui->layerVisible->setChecked(visible);
+    ui->layerOpacity->setValue(opacity);
+    ui->layerBlendMode->setCurrentIndex(int(mode));
+    ui->deleteLayer->setEnabled(layerCount > 1);
+}
+
+void MainWindow::requestTransform(const FrameTransform& transform)
+{
+    emit transformRequested(transform, ui->transformCurrentFrameOnlyAction->isChecked());
+}
+
+void MainWindow::shiftClicked()
+{
+    bool ok;
+    const int dx = QInputDialog::getInt(this, "Shift", "Pixels to the right (wraps around):", 0, -Sprite::MAX_SIZE, Sprite::MAX_SIZE, 1, &ok);
+    if (!ok)
+        return;
+    const int dy = QInputDialog::getInt(this, "Shift", "Pixels down (wraps around):", 0, -Sprite::MAX_SIZE, Sprite::MAX_SIZE, 1, &ok);
+    if (!ok || (dx == 0 && dy == 0))
+        return;
+    requestTransform(FrameTransform(TransformType::SHIFT, dx, dy));
+}
+
+void MainWindow::replaceColorClicked()
+{
+    const QColor color = QColorDialog::getColor(currentColor, this, "Replace Current Color With", QColorDialog::ShowAlphaChannel);
+    if (!color.isValid())
+        return;
+    bool ok;
+    const int tolerance = QInputDialog::getInt(this, "Replace Color", "Largest difference in any channel (0 for exact):", 0, 0, 255, 1, &ok);
+    if (!ok)
+        return;
+    emit colorReplaceRequested(currentColor, color, tolerance, ui->transformCurrentFrameOnlyAction->isChecked());
+}
+
+void MainWindow::recolorPaletteClicked()
+{
+    const QColor color = QColorDialog::getColor(currentColor, this, "Recolor Palette Entry", QColorDialog::ShowAlphaChannel);
+    if (!color.isValid())
+        return;
+    emit paletteColorReplaced(currentColor, color);
+}
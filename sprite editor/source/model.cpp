@@ -10,35 +10,240 @@
  **/
 
 #include "model.h"
-#include <QQueue>
-#include <QSet>
-#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <memory>
 
-Model::Model(QObject *parent) : QObject{parent} {
+Model::Model(QObject *parent)
+    : QObject{parent}, journal{QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/recovery"} {
+    // Leave a core for the UI thread
+    thumbnailPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+
+    // A single thread runs saves in the order they were requested, so the last save always wins
+    savePool.setMaxThreadCount(1);
 }
 
 Model::~Model(){
+    // Let a save in flight finish rather than losing it
+    savePool.waitForDone();
+    thumbnailPool.waitForDone();
+    journal.discard();
     delete sprite;
 }
 
+bool Model::hasRecovery() const{
+    return journal.hasRecovery();
+}
+
 void Model::editImage(QPoint pos){
+    if (sprite == nullptr || !sprite->contains(pos))
+        return;
+
+    QRect dirtyRect;
     switch(currentTool){
     case Tool::PEN:
-        sprite->setPixel(pos, currentColor);
+        dirtyRect = brush.stroke(layerPixels(), isEditing ? editBefore : layerPixels(), {pos}, currentColor.rgba(), blendMode);
         break;
     case Tool::ERASER:
-        sprite->setPixel(pos, QColor(0,0,0,0));
+        dirtyRect = brush.stroke(layerPixels(), layerPixels(), {pos}, qRgba(0, 0, 0, 0), BlendMode::REPLACE);
         break;
     case Tool::FILL:
-        Model::fillImage(pos);
+        dirtyRect = Model::fillImage(pos);
         break;
     case Tool::EYEDROPPER:
-        currentColor = sprite->getColor(pos);
+        currentColor = QColor::fromRgba(sprite->getPixel(pos));
         emit updateColor(currentColor);
     default:
         return;
     }
-    emit canvasDraw(sprite->getFrame());
+    if (!dirtyRect.isEmpty())
+        frameEdited(dirtyRect);
+}
+
+void Model::editStroke(const QVector<QPoint>& positions, bool newStroke){
+    if (sprite == nullptr || positions.isEmpty())
+        return;
+
+    if (newStroke) {
+        commitEdit();
+        beginEdit();
+    }
+
+    switch(currentTool){
+    case Tool::PEN:
+    case Tool::ERASER:
+        break;
+    case Tool::FILL:
+        // Dragging with the fill tool should not refill on every move
+        if (newStroke)
+            editImage(positions.first());
+        return;
+    default:
+        editImage(positions.last());
+        return;
+    }
+
+    // The pen blends onto the layer as it was when the stroke started, so overlapping segments do not build up
+    const QRgb color = currentTool == Tool::PEN ? currentColor.rgba() : qRgba(0, 0, 0, 0);
+    const BlendMode mode = currentTool == Tool::PEN ? blendMode : BlendMode::REPLACE;
+    Frame& pixels = layerPixels();
+    const Frame& under = isEditing ? editBefore : pixels;
+
+    // Stamp the brush along the batch a segment at a time, continuing from where the last batch of this stroke ended
+    QVector<QPoint> centers;
+    QRect dirtyRect;
+    int start = 0;
+    if (newStroke) {
+        centers.append(positions.first());
+        lastStrokePos = positions.first();
+        start = 1;
+    }
+    for (int i = start; i < positions.size(); i++) {
+        appendLine(lastStrokePos, positions[i], centers);
+        lastStrokePos = positions[i];
+        dirtyRect |= brush.stroke(pixels, under, centers, color, mode);
+        centers.clear();
+    }
+    if (!centers.isEmpty())
+        dirtyRect |= brush.stroke(pixels, under, centers, color, mode);
+    if (!dirtyRect.isEmpty())
+        frameEdited(dirtyRect);
+}
+
+void Model::endStroke(){
+    commitEdit();
+}
+
+void Model::beginEdit(){
+    isEditing = true;
+    editFrameIndex = sprite->getCurrentFrameIndex();
+    editLayerIndex = currentLayer;
+    editBefore = layerPixels(); // Shares the layer's tiles, only the ones drawn on get cloned
+    editDirtyRect = QRect();
+}
+
+void Model::commitEdit(){
+    if (!isEditing)
+        return;
+
+    isEditing = false;
+    const Frame after = sprite->getLayer(editFrameIndex, editLayerIndex).pixels;
+    history.recordPixels(editFrameIndex, editLayerIndex, editBefore, after, editDirtyRect);
+    journal.recordPixels(editFrameIndex, editLayerIndex, editBefore, after, editDirtyRect);
+    journal.compactIfLarge(*sprite);
+    editBefore = Frame();
+    emit historyChanged(history.canUndo(), history.canRedo());
+}
+
+Frame& Model::layerPixels(){
+    return sprite->getLayerPixels(sprite->getCurrentFrameIndex(), currentLayer);
+}
+
+void Model::frameEdited(QRect dirtyRect){
+    editDirtyRect |= dirtyRect;
+    const QRect changed = sprite->layerEdited(sprite->getCurrentFrameIndex(), currentLayer, dirtyRect);
+    emit canvasDraw(sprite->getFrame(), changed);
+    emit previewsInvalidated(sprite->getCurrentFrameIndex(), sprite->getCurrentFrameIndex());
+}
+
+void Model::updateLayers(){
+    const int frameIndex = sprite->getCurrentFrameIndex();
+    currentLayer = qBound(0, currentLayer, sprite->getLayerCount(frameIndex) - 1);
+    const Layer layer = sprite->getLayer(frameIndex, currentLayer);
+    emit layersChanged(sprite->getLayerCount(frameIndex), currentLayer, layer.visible, qRound(layer.opacity * 100 / 255.0), layer.mode);
+}
+
+void Model::layersEdited(){
+    journal.compactIfLarge(*sprite);
+    emit historyChanged(history.canUndo(), history.canRedo());
+    emit previewsInvalidated(sprite->getCurrentFrameIndex(), sprite->getCurrentFrameIndex());
+    refreshOnionSkin();
+    updateLayers();
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+}
+
+void Model::undo(){
+    if (sprite == nullptr)
+        return;
+
+    commitEdit();
+    const int frameCount = sprite->getFrameCount();
+    History::Change change;
+    const int frameIndex = history.undo(*sprite, &change);
+    if (frameIndex >= 0) {
+        journal.recordChange(change, *sprite);
+        journal.compactIfLarge(*sprite);
+    }
+    historyApplied(frameIndex, frameCount, change);
+}
+
+void Model::redo(){
+    if (sprite == nullptr)
+        return;
+
+    commitEdit();
+    const int frameCount = sprite->getFrameCount();
+    History::Change change;
+    const int frameIndex = history.redo(*sprite, &change);
+    if (frameIndex >= 0) {
+        journal.recordChange(change, *sprite);
+        journal.compactIfLarge(*sprite);
+    }
+    historyApplied(frameIndex, frameCount, change);
+}
+
+void Model::historyApplied(int frameIndex, int previousFrameCount, const History::Change& change){
+    if (frameIndex < 0)
+        return;
+
+    // Adding or removing a frame shifts the frames after it, and a transform or recolor may change many frames
+    if (change.type == History::ChangeType::TRANSFORM)
+        framesTransformed(change.frameIndex, change.lastFrameIndex, change.transform);
+    else if (change.type == History::ChangeType::PIXEL_BATCH)
+        emit previewsInvalidated(change.frameIndex, change.lastFrameIndex);
+    else if (change.type == History::ChangeType::SET_PALETTE)
+        emit previewsInvalidated(0, -1);
+    else if (sprite->getFrameCount() == previousFrameCount)
+        emit previewsInvalidated(frameIndex, frameIndex);
+    else
+        emit previewsInvalidated(frameIndex, -1);
+
+    currentAnimationFrameIndex = 0;
+    sprite->getFrame(frameIndex, true);
+    refreshOnionSkin();
+    updateLayers();
+    emit framesChanged(sprite->getFrameCount(), frameIndex);
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+    emit historyChanged(history.canUndo(), history.canRedo());
+}
+
+void Model::setHistoryBudget(qsizetype bytes){
+    history.setBudget(bytes);
+    emit historyChanged(history.canUndo(), history.canRedo());
+}
+
+void Model::appendLine(QPoint from, QPoint to, QVector<QPoint>& points){
+    const int dx = qAbs(to.x() - from.x());
+    const int dy = -qAbs(to.y() - from.y());
+    const int stepX = from.x() < to.x() ? 1 : -1;
+    const int stepY = from.y() < to.y() ? 1 : -1;
+    int error = dx + dy;
+    int x = from.x();
+    int y = from.y();
+
+    while (x != to.x() || y != to.y()) {
+        const int doubledError = 2 * error;
+        if (doubledError >= dy) {
+            error += dy;
+            x += stepX;
+        }
+        if (doubledError <= dx) {
+            error += dx;
+            y += stepY;
+        }
+        points.append(QPoint(x, y));
+    }
 }
 
 void Model::changeTool(Tool tool){
@@ -49,87 +254,409 @@ void Model::changeColor(QColor color){
     currentColor = color;
 }
 
-void Model::setupSprite(int size){
-    sprite = new Sprite(size);
+void Model::changeBlendMode(BlendMode mode){
+    blendMode = mode;
+}
+
+void Model::changeBrushSize(int size){
+    brush = Brush(brush.getShape(), size);
+}
+
+void Model::changeBrushShape(BrushShape shape){
+    brush = Brush(shape, brush.getSize());
+}
+
+void Model::changeOnionSkinRange(int frames){
+    onionSkin.setRange(frames);
+    if (sprite == nullptr)
+        return;
+
+    const QRect changed = refreshOnionSkin();
+    if (!changed.isEmpty())
+        emit canvasDraw(sprite->getFrame(), changed);
+}
+
+QRect Model::refreshOnionSkin(){
+    const QRect changed = onionSkin.update(*sprite);
+    if (!changed.isEmpty())
+        emit onionSkinChanged(onionSkin.getComposite());
+    return changed;
+}
+
+void Model::addLayer(){
+    if (sprite == nullptr)
+        return;
+
+    commitEdit();
+    const int frameIndex = sprite->getCurrentFrameIndex();
+    if (!sprite->addLayer(frameIndex, currentLayer + 1))
+        return;
+    currentLayer++;
+    history.recordLayerAdded(frameIndex, currentLayer);
+    journal.recordLayerAdded(frameIndex, currentLayer);
+    layersEdited();
+}
+
+void Model::deleteLayer(){
+    const int frameIndex = sprite == nullptr ? 0 : sprite->getCurrentFrameIndex();
+    if (sprite == nullptr || sprite->getLayerCount(frameIndex) <= 1)
+        return;
+
+    commitEdit();
+    history.recordLayerDeleted(frameIndex, currentLayer, sprite->getLayer(frameIndex, currentLayer));
+    sprite->deleteLayer(frameIndex, currentLayer);
+    journal.recordLayerDeleted(frameIndex, currentLayer);
+    currentLayer = qMax(0, currentLayer - 1);
+    layersEdited();
+}
+
+void Model::selectLayer(int layerIndex){
+    if (sprite == nullptr || layerIndex == currentLayer)
+        return;
+
+    commitEdit();
+    currentLayer = layerIndex;
+    updateLayers();
+}
+
+void Model::setLayer(const Layer& layer){
+    const int frameIndex = sprite->getCurrentFrameIndex();
+    const Layer before = sprite->getLayer(frameIndex, currentLayer);
+    if (sprite->isIndexed() || (layer.visible == before.visible && layer.opacity == before.opacity && layer.mode == before.mode)) {
+        updateLayers();
+        return;
+    }
+
+    commitEdit();
+    sprite->setLayerProperties(frameIndex, currentLayer, layer.visible, layer.opacity, layer.mode);
+    history.recordLayerChanged(frameIndex, currentLayer, before, layer);
+    journal.recordLayerChanged(frameIndex, currentLayer, layer);
+    layersEdited();
+}
+
+void Model::setLayerVisible(bool visible){
+    if (sprite == nullptr)
+        return;
+    Layer layer = sprite->getLayer(sprite->getCurrentFrameIndex(), currentLayer);
+    layer.visible = visible;
+    setLayer(layer);
+}
+
+void Model::setLayerOpacity(int percent){
+    if (sprite == nullptr)
+        return;
+    Layer layer = sprite->getLayer(sprite->getCurrentFrameIndex(), currentLayer);
+    layer.opacity = quint8(qRound(qBound(0, percent, 100) * 255 / 100.0));
+    setLayer(layer);
+}
+
+void Model::setLayerBlendMode(BlendMode mode){
+    if (sprite == nullptr)
+        return;
+    Layer layer = sprite->getLayer(sprite->getCurrentFrameIndex(), currentLayer);
+    layer.mode = mode;
+    setLayer(layer);
+}
+
+void Model::transformFrames(FrameTransform transform, bool currentFrameOnly){
+    if (sprite == nullptr)
+        return;
+
+    commitEdit();
+    const int firstFrame = currentFrameOnly ? sprite->getCurrentFrameIndex() : 0;
+    const int lastFrame = currentFrameOnly ? firstFrame : sprite->getFrameCount() - 1;
+    if (!sprite->transformFrames(firstFrame, lastFrame, transform)) {
+        qDebug() << "Only square sprites can be turned a quarter turn";
+        return;
+    }
+    history.recordTransform(firstFrame, lastFrame, transform);
+    journal.recordTransform(firstFrame, lastFrame, transform);
+    journal.compactIfLarge(*sprite);
+    emit historyChanged(history.canUndo(), history.canRedo());
+
+    framesTransformed(firstFrame, lastFrame, transform);
+    refreshOnionSkin();
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+}
+
+void Model::replaceColor(QColor from, QColor to, int tolerance, bool currentFrameOnly){
+    if (sprite == nullptr)
+        return;
+
+    commitEdit();
+    const int firstFrame = currentFrameOnly ? sprite->getCurrentFrameIndex() : 0;
+    const int lastFrame = currentFrameOnly ? firstFrame : sprite->getFrameCount() - 1;
+    tolerance = qBound(0, tolerance, 255);
+    const QVector<Sprite::FrameEdit> edits = sprite->replaceColor(firstFrame, lastFrame, from.rgba(), to.rgba(), tolerance);
+    if (edits.isEmpty())
+        return;
+    history.recordFrameEdits(edits);
+    journal.recordColorReplaced(firstFrame, lastFrame, from.rgba(), to.rgba(), tolerance);
+    journal.compactIfLarge(*sprite);
+    emit historyChanged(history.canUndo(), history.canRedo());
+
+    emit previewsInvalidated(edits.first().frameIndex, edits.last().frameIndex);
+    refreshOnionSkin();
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+}
+
+void Model::framesTransformed(int firstFrame, int lastFrame, const FrameTransform& transform){
+    if (transform.isRecolor() && sprite->isIndexed())
+        emit previewsInvalidated(0, -1);
+    else
+        emit previewsInvalidated(firstFrame, lastFrame);
+}
+
+void Model::changeFillTolerance(int tolerance){
+    fillTolerance = qBound(0, tolerance, 255);
+}
+
+void Model::changeFillConnectivity(Connectivity connectivity){
+    fillConnectivity = connectivity;
+}
+
+void Model::setupSprite(int width, int height){
+    isEditing = false;
+    delete sprite;
+    sprite = new Sprite(width, height);
     currentAnimationFrameIndex = 0;
-    emit canvasDraw(sprite->getFrame());
+    currentLayer = 0;
+    history.clear();
+    journal.start(*sprite);
+    refreshOnionSkin();
+    updateLayers();
+    emit historyChanged(false, false);
+    emit indexedModeChanged(false);
+    emit previewsInvalidated(0, -1);
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+}
+
+void Model::redrawCanvas(){
+    if (sprite != nullptr)
+        emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
 }
 
 void Model::addSpriteFrame(){
+    commitEdit();
     sprite->addFrame();
+    history.recordFrameAdded(sprite->getFrameCount() - 1);
+    journal.recordFrameAdded();
+    journal.compactIfLarge(*sprite);
+    emit historyChanged(history.canUndo(), history.canRedo());
+    emit previewsInvalidated(sprite->getFrameCount() - 1, -1);
+
+    // The new frame may be shown in the onion skin of the current one
+    const QRect onionSkinChanged = refreshOnionSkin();
+    if (!onionSkinChanged.isEmpty())
+        emit canvasDraw(sprite->getFrame(), onionSkinChanged);
 }
 
 void Model::deleteSpriteFrame(int frameIndex){
     if(sprite == nullptr)
         return;
 
+    commitEdit();
+    history.recordFrameDeleted(frameIndex, sprite->getFrame(frameIndex, false), sprite->getLayers(frameIndex));
+    emit historyChanged(history.canUndo(), history.canRedo());
+
     currentAnimationFrameIndex = 0;
     sprite->deleteFrame(frameIndex);
+    journal.recordFrameDeleted(frameIndex);
+    journal.compactIfLarge(*sprite);
+    emit previewsInvalidated(frameIndex, -1);
     sprite->getFrame(0, true);
-    emit canvasDraw(sprite->getFrame());
+    refreshOnionSkin();
+    updateLayers();
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
 }
 
 void Model::duplicateSpriteFrame(int frameIndex)
 {
+    commitEdit();
     sprite->duplicateFrame(frameIndex);
+    emit previewsInvalidated(frameIndex + 1, -1);
+    history.recordFrameDuplicated(frameIndex);
+    journal.recordFrameDuplicated(frameIndex);
+    journal.compactIfLarge(*sprite);
+    emit historyChanged(history.canUndo(), history.canRedo());
+
+    const QRect onionSkinChanged = refreshOnionSkin();
+    if (!onionSkinChanged.isEmpty())
+        emit canvasDraw(sprite->getFrame(), onionSkinChanged);
 }
 
 void Model::setSpriteFrame(int frameID){
     if(sprite == nullptr)
         return;
 
+    commitEdit();
     sprite->getFrame(frameID - 1, true);
-    emit canvasDraw(sprite->getFrame());
+    refreshOnionSkin();
+    updateLayers();
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
 }
 
 void Model::animateNextFrame(){
-    emit animated(sprite->getFrame(currentAnimationFrameIndex, false));
+    emit animated(currentAnimationFrameIndex);
     // Increment frameIndex (loop it)
     currentAnimationFrameIndex = (currentAnimationFrameIndex + 1) % sprite->getFrameCount();
 }
 
-void Model::fillImage(QPoint pos){
-    QColor formerColor = sprite->getColor(pos);
-    QQueue<QPoint> q;
-    QSet<QPoint> visited;
-    q.enqueue(pos);
-    sprite->setPixel(pos, currentColor);
-    while (!q.empty()) {
-        QPoint currentPoint = q.dequeue();
-        if (!visited.contains(currentPoint)) {
-            visited.insert(currentPoint);
-            QPoint newPoints[4] = {QPoint(currentPoint.x() + 1, currentPoint.y()), QPoint(currentPoint.x() - 1, currentPoint.y()), QPoint(currentPoint.x(), currentPoint.y() + 1), QPoint(currentPoint.x() + 1, currentPoint.y() - 1)};
-            for (QPoint point : newPoints){
-                if (!(point.x() < 0 || point.x() >= sprite->getWidth() || point.y() < 0 || point.y() >= sprite->getWidth()) && formerColor == sprite->getColor(point)) {
-                    q.enqueue(point);
-                    sprite->setPixel(point, currentColor);
-                }
-            }
-        }
-    }
+void Model::requestPreview(int frameIndex){
+    if (sprite == nullptr || frameIndex < 0 || frameIndex >= sprite->getFrameCount())
+        return;
+
+    const Frame& frame = sprite->getFrame(frameIndex, false);
+    QSize size = frame.getRect().size();
+    if (size.width() > Sprite::PREVIEW_SIZE || size.height() > Sprite::PREVIEW_SIZE)
+        emit previewReady(frameIndex, frame.toImage(size.scaled(Sprite::PREVIEW_SIZE, Sprite::PREVIEW_SIZE, Qt::KeepAspectRatio).expandedTo(QSize(1, 1))));
+    else
+        emit previewReady(frameIndex, frame.toImage());
+}
+
+void Model::requestThumbnail(int frameIndex, quint64 revision, int size){
+    if (sprite == nullptr || frameIndex < 0 || frameIndex >= sprite->getFrameCount())
+        return;
+
+    // Copying the frame only copies its tile pointers, and edits made while the worker reads clone the tiles
+    const Frame frame = sprite->getFrame(frameIndex, false);
+    const QSize thumbnailSize = frame.getRect().size().scaled(size, size, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    thumbnailPool.start([this, frame, frameIndex, revision, thumbnailSize]() {
+        const QImage thumbnail = frame.toImage(thumbnailSize);
+        QMetaObject::invokeMethod(this, [this, frameIndex, revision, thumbnail]() {
+            emit thumbnailReady(frameIndex, revision, thumbnail);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QRect Model::fillImage(QPoint pos){
+    return FloodFill::fill(layerPixels(), pos, currentColor.rgba(), fillTolerance, fillConnectivity, blendMode);
 }
 
 void Model::Serialize(QString path){
-    QFile json(path);
-    if (!json.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        qDebug() << "Failed to open file for writing:" << json.errorString();
+    if (sprite == nullptr)
         return;
-    }
-    json.write(sprite->Serialize().toUtf8());
-    json.close();
-    //TODO: Fix 'device not open' error
+
+#ifdef Q_OS_WIN
+    // Windows cannot replace a file while it is mapped, so stop decoding frames from it first
+    if (sprite->isOpenedFrom(path))
+        sprite->detachSource();
+#endif
+
+    // Copying the sprite only copies its tile pointers, and edits made during the save clone the tiles
+    const std::shared_ptr<Sprite> snapshot = std::make_shared<Sprite>(*sprite);
+    savePool.start([this, snapshot, path]() {
+        // Only a committed file is a successful save, and a failure always carries a reason, as the device
+        // may not have set one when Serialize stopped
+        QString error;
+        QSaveFile file(path);
+        const bool saved = file.open(QIODevice::WriteOnly) && snapshot->Serialize(file) && file.commit();
+        if (!saved)
+            error = file.errorString().isEmpty() ? QString("Failed to write project") : file.errorString();
+
+        QMetaObject::invokeMethod(this, [this, path, error]() {
+            if (!error.isEmpty())
+                qDebug() << "Failed to write project:" << error;
+            emit saveFinished(path, error);
+        }, Qt::QueuedConnection);
+    });
 }
 
 void Model::Deserialize(QString path){
-    QFile json(path);
-    json.open(QIODevice::ReadOnly);
-    sprite = sprite->Deserialize(json.readAll());
-    json.close();
-    //TODO: Fix 'device not open' error
+    // Only the frames' locations are read now, each frame is decoded when it is first shown
+    Sprite* loadedSprite = Sprite::Open(path, [this](int percent) {
+        emit loadProgress(percent);
+    });
+    emit loadProgress(100);
+
+    if (loadedSprite == nullptr) {
+        qDebug() << "Failed to load project:" << path;
+        return;
+    }
+    loadSprite(loadedSprite);
+}
+
+void Model::recover(){
+    Sprite* recoveredSprite = journal.recover();
+    if (recoveredSprite == nullptr) {
+        qDebug() << "Failed to recover project";
+        return;
+    }
+    loadSprite(recoveredSprite);
+}
+
+void Model::loadSprite(Sprite* loadedSprite){
+    isEditing = false;
+    delete sprite;
+    sprite = loadedSprite;
+    currentLayer = 0;
+    history.clear();
+    journal.start(*sprite);
+    refreshOnionSkin();
+    updateLayers();
+    emit historyChanged(false, false);
+    emit indexedModeChanged(sprite->isIndexed());
 
     currentAnimationFrameIndex = 0;
-    emit loadedProject(sprite->getWidth(), sprite->getFrameCount());
-    emit canvasDraw(sprite->getFrame());
+    emit previewsInvalidated(0, -1);
+    emit loadedProject(sprite->getWidth(), sprite->getHeight(), sprite->getFrameCount());
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+}
+
+void Model::setIndexedMode(bool indexed){
+    if (sprite == nullptr)
+        return;
+
+    commitEdit();
+    if (indexed != sprite->isIndexed()) {
+        QString error;
+        if (!indexed) {
+            sprite->convertToRgb();
+        } else if (sprite->convertToIndexed(error)) {
+            // Undone edits could bring back layers, which indexed sprites cannot have, so the history starts
+            // again from the indexed sprite
+            history.clear();
+            emit historyChanged(false, false);
+        } else {
+            emit indexedModeChanged(false);
+            emit indexedModeFailed(error);
+            return;
+        }
+
+        // The journal records edits rather than formats, so start it again from the converted sprite
+        journal.start(*sprite);
+        refreshOnionSkin();
+        emit previewsInvalidated(0, -1);
+        emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+    }
+    emit indexedModeChanged(sprite->isIndexed());
 }
 
+void Model::replacePaletteColor(QColor from, QColor to){
+    if (sprite == nullptr || !sprite->isIndexed() || from.rgba() == to.rgba())
+        return;
+
+    // Only entries holding the color exactly change, as the closest entry may be an unrelated color
+    const QVector<int> indices = sprite->getPalette().indicesOf(from.rgba());
+    if (indices.isEmpty()) {
+        qDebug() << "The palette has no entry of the current color to recolor";
+        return;
+    }
+
+    commitEdit();
+    for (int index : indices) {
+        sprite->setPaletteColor(index, to.rgba());
+        journal.recordPaletteColor(index, to.rgba());
+    }
+    journal.compactIfLarge(*sprite);
+    history.recordPaletteColors(sprite->getCurrentFrameIndex(), indices, from.rgba(), to.rgba());
+    emit historyChanged(history.canUndo(), history.canRedo());
 
+    // Keep drawing with the entry which was just recolored
+    currentColor = to;
+    emit updateColor(currentColor);
+
+    refreshOnionSkin();
+    emit previewsInvalidated(0, -1);
+    emit canvasDraw(sprite->getFrame(), sprite->getFrame().getRect());
+}
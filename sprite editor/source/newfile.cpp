@@ -19,6 +19,7 @@ NewFile::NewFile(QWidget *parent)
     connect(ui->confirmButton, &QDialogButtonBox::accepted, this, &NewFile::confirmButtonClicked);
     connect(ui->confirmButton, &QDialogButtonBox::rejected, this, &NewFile::rejectedButton);
     connect(ui->sizeInput, &QLineEdit::textChanged, this, &NewFile::badNumText);
+    connect(ui->heightInput, &QLineEdit::textChanged, this, &NewFile::badNumText);
     ui->smallerNumber->hide();
 }
 
@@ -29,23 +30,27 @@ NewFile::~NewFile(){
 void NewFile::confirmButtonClicked(){
 
     QString input = ui->sizeInput->text();
+    QString heightInput = ui->heightInput->text();
+    if (heightInput.isEmpty())
+        heightInput = input; // Square by default
 
-    bool isInt;
+    bool isInt, isHeightInt;
     int numberInput = input.toInt(&isInt);
+    int heightNumber = heightInput.toInt(&isHeightInt);
 
     // Case for invalid input
-    if(!isInt){
+    if(!isInt || !isHeightInt){
         ui->smallerNumber->show();
         return; // An int was not input so do nothing
     }
 
     // Checks for a valid entry
-    if (numberInput > 64 || numberInput < 1){
+    if (numberInput > Sprite::MAX_SIZE || numberInput < 1 || heightNumber > Sprite::MAX_SIZE || heightNumber < 1){
         ui->smallerNumber->show();
         return;
     }
 
-    emit sendSize(numberInput);
+    emit sendSize(numberInput, heightNumber);
     this->hide();
 }
 
@@ -0,0 +1,105 @@
+/**
+ * The frames before and after the current one, faded with distance and composited into a single image the
+ * canvas shows beneath the current frame. The composite is kept between updates along with copies of the
+ * frames it was made from, and only the tiles where a neighbor no longer shares its tile with its copy are
+ * composited again, so drawing on or flipping between frames which share most of their tiles stays cheap.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "onionskin.h"
+#include "blend.h"
+
+void OnionSkin::setRange(int frames){
+    range = qBound(0, frames, MAX_RANGE);
+}
+
+int OnionSkin::getRange() const{
+    return range;
+}
+
+const Frame& OnionSkin::getComposite() const{
+    return composite;
+}
+
+uint OnionSkin::opacity(int distance) const{
+    // Fades linearly, so the farthest frame shown is still faintly visible
+    return OPACITY * (range + 1 - distance) / range;
+}
+
+QRect OnionSkin::update(Sprite& sprite){
+    if (range == 0) {
+        const QRect previous = composite.getRect();
+        composite = Frame();
+        neighbors.clear();
+        return previous;
+    }
+
+    // Copying a frame shares its tiles, so the copies cost little and show later which tiles were drawn on
+    const int currentIndex = sprite.getCurrentFrameIndex();
+    QVector<Frame> frames(2 * range);
+    for (int distance = 1; distance <= range; distance++) {
+        if (currentIndex - distance >= 0)
+            frames[2 * (distance - 1)] = sprite.getFrame(currentIndex - distance, false);
+        if (currentIndex + distance < sprite.getFrameCount())
+            frames[2 * (distance - 1) + 1] = sprite.getFrame(currentIndex + distance, false);
+    }
+
+    const QRect spriteRect(0, 0, sprite.getWidth(), sprite.getHeight());
+    bool redrawAll = false;
+    if (composite.getRect() != spriteRect || neighbors.size() != frames.size()) {
+        composite = Frame(spriteRect.width(), spriteRect.height());
+        redrawAll = true;
+    }
+
+    // Find the tiles where any neighbor changed since the composite was last made
+    const int columns = composite.getTileColumns();
+    const int rows = composite.getTileRows();
+    QVector<bool> dirty(qsizetype(columns) * rows, redrawAll);
+    for (qsizetype i = 0; i < frames.size() && !redrawAll; i++) {
+        const Frame& before = neighbors.at(i);
+        const Frame& after = frames.at(i);
+        if (before.isNull() && after.isNull())
+            continue;
+        if (before.isNull() != after.isNull() || before.getRect() != after.getRect()) {
+            dirty.fill(true);
+            break;
+        }
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                if (!after.sharesTile(before, column, row))
+                    dirty[qsizetype(row) * columns + column] = true;
+            }
+        }
+    }
+    neighbors = frames;
+
+    // Composite the dirty tiles, farthest frames first so the nearest end up on top
+    QRect changed;
+    QVector<QRgb> line(Frame::TILE_SIZE);
+    QVector<QRgb> pixels(Frame::TILE_SIZE);
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            if (!dirty.at(qsizetype(row) * columns + column))
+                continue;
+
+            const QRect tile = composite.tileRect(column, row);
+            for (int y = tile.top(); y <= tile.bottom(); y++) {
+                line.fill(0);
+                for (int distance = range; distance >= 1; distance--) {
+                    for (int side = 0; side < 2; side++) {
+                        const Frame& frame = neighbors.at(2 * (distance - 1) + side);
+                        if (frame.isNull())
+                            continue;
+                        frame.readRow(tile.left(), y, tile.width(), pixels.data());
+                        Blend::blendLayer(line.data(), pixels.constData(), tile.width(), opacity(distance), BlendMode::SOURCE_OVER);
+                    }
+                }
+                composite.writeRow(tile.left(), y, tile.width(), line.constData());
+            }
+            changed |= tile;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,75 @@
+/**
+ * A palette of up to 256 colors for indexed frames. Copying a palette is cheap, as its tables are shared
+ * until one of the copies is changed, so every frame of a sprite can hold its own copy.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "palette.h"
+#include <algorithm>
+#include <limits>
+
+Palette::Palette() : Palette(QVector<QRgb>{qRgba(0, 0, 0, 0)}) {}
+
+Palette::Palette(const QVector<QRgb>& colors) : colors(MAX_COLORS, qRgba(0, 0, 0, 0)) {
+    count = qMin(int(colors.size()), MAX_COLORS);
+    std::copy(colors.begin(), colors.begin() + count, this->colors.begin());
+    rebuildLookup();
+}
+
+int Palette::size() const{
+    return count;
+}
+
+void Palette::setColor(int index, QRgb color){
+    colors[index] = color;
+    rebuildLookup();
+}
+
+void Palette::rebuildLookup(){
+    lookup.clear();
+    for (int i = count - 1; i >= 0; i--)
+        lookup.insert(colors.at(i), i);
+}
+
+quint8 Palette::indexOf(QRgb color) const{
+    const auto exact = lookup.constFind(color);
+    if (exact != lookup.constEnd())
+        return quint8(*exact);
+
+    // Otherwise the closest color, measured over all four channels
+    int best = 0;
+    int bestDistance = std::numeric_limits<int>::max();
+    for (int i = 0; i < count; i++) {
+        const QRgb candidate = colors.at(i);
+        const int red = qRed(candidate) - qRed(color);
+        const int green = qGreen(candidate) - qGreen(color);
+        const int blue = qBlue(candidate) - qBlue(color);
+        const int alpha = qAlpha(candidate) - qAlpha(color);
+        const int distance = red * red + green * green + blue * blue + alpha * alpha;
+        if (distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    return quint8(best);
+}
+
+QVector<int> Palette::indicesOf(QRgb color) const{
+    QVector<int> indices;
+    for (int i = 0; i < count; i++) {
+        if (colors.at(i) == color)
+            indices.append(i);
+    }
+    return indices;
+}
+
+bool Palette::operator==(const Palette& other) const{
+    // Copies of one palette share their table, which makes the common case a pointer comparison
+    return count == other.count && (colors.constData() == other.colors.constData() || colors == other.colors);
+}
+
+bool Palette::operator!=(const Palette& other) const{
+    return !(*this == other);
+}
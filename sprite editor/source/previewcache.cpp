@@ -0,0 +1,40 @@
+/**
+ * Ready to display pixmaps of each frame for the animation preview, so playing the preview only has to hand a
+ * cached pixmap to each label. Entries are dropped when their frame changes or the preview is resized, and
+ * the least recently shown ones are evicted once the cache grows past its byte budget.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "previewcache.h"
+
+PreviewCache::PreviewCache(qsizetype budget) : entries(budget) {}
+
+void PreviewCache::setScaledSize(QSize size){
+    if (size == scaledSize)
+        return;
+    scaledSize = size;
+    entries.clear();
+}
+
+const PreviewCache::Entry* PreviewCache::find(int frameIndex) const{
+    return entries.object(frameIndex);
+}
+
+void PreviewCache::insert(int frameIndex, const QImage& image){
+    Entry* entry = new Entry;
+    entry->realSize = QPixmap::fromImage(image);
+    entry->scaled = entry->realSize.scaled(scaledSize, Qt::KeepAspectRatio, Qt::FastTransformation);
+
+    const qsizetype cost = (qsizetype(entry->realSize.width()) * entry->realSize.height()
+                            + qsizetype(entry->scaled.width()) * entry->scaled.height()) * 4;
+    entries.insert(frameIndex, entry, cost); // Takes ownership of the entry
+}
+
+void PreviewCache::invalidate(int firstFrame, int lastFrame){
+    for (int frameIndex : entries.keys()) {
+        if (frameIndex >= firstFrame && (lastFrame < 0 || frameIndex <= lastFrame))
+            entries.remove(frameIndex);
+    }
+}
@@ -1,6 +1,6 @@
 /**
  * File representing a Sprite object.
- * A Sprite can contain multiple frames as QImage objects.
+ * A Sprite can contain multiple frames as copy on write tiled Frame objects.
  * You can add and remove frames, as well as save/load sprites to/from files
  *
  * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
@@ -10,44 +10,280 @@
  **/
 
 #include "sprite.h"
+#include "legacyprojectreader.h"
+#include "recolor.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSemaphore>
+#include <QSet>
+#include <QThreadPool>
+#include <QtEndian>
+#include <algorithm>
 
-Sprite::Sprite(int width) : width{width} {
+struct Sprite::FrameSource {
+    /**
+     * Where one frame chunk is in the file.
+     */
+    struct Chunk {
+        qint64 offset = 0; // Where the chunk starts, just after its size
+        quint32 size = 0;
+        bool keyframe = true; // False for a delta, which is decoded on top of the chunk before it
+    };
+
+    QFile file;
+    const uchar* data = nullptr; // The whole file, mapped read only, so any thread can decode from it
+    qint64 size = 0;
+    quint16 flags = 0;
+    QVector<Chunk> chunks;       // Every frame chunk in file order
+};
+
+/**
+ * Appends the pixels of a rectangle of a frame to a chunk row by row, as palette indices if the frame is
+ * indexed and as little endian ARGB32 words otherwise.
+ * @param scratch - room for the rectangle's ARGB32 pixels, as the chunk may not be aligned for them
+ */
+static void appendPixels(QByteArray& chunk, const Frame& frame, QRect rect, QVector<QRgb>& scratch){
+    const qsizetype count = qsizetype(rect.width()) * rect.height();
+    const qsizetype offset = chunk.size();
+    if (frame.isIndexed()) {
+        chunk.resize(offset + count);
+        frame.readIndices(rect, reinterpret_cast<quint8*>(chunk.data() + offset));
+        return;
+    }
+    chunk.resize(offset + count * qsizetype(sizeof(QRgb)));
+    frame.readRect(rect, scratch.data());
+    qToLittleEndian<quint32>(scratch.constData(), count, chunk.data() + offset);
+}
+
+/**
+ * Appends a little endian word to a chunk.
+ */
+static void appendWord(QByteArray& chunk, quint32 value){
+    char bytes[sizeof(quint32)];
+    qToLittleEndian<quint32>(value, bytes);
+    chunk.append(bytes, sizeof(bytes));
+}
+
+Sprite::Sprite(int width, int height) : width{width}, height{height} {
     addFrame();
     currentFrameIndex = 0;
 }
 
 Sprite::~Sprite(){}
 
-void Sprite::setPixel(QPoint pos, QColor color){
-    QImage& currentFrame = frames.at(currentFrameIndex);
-    currentFrame.setPixelColor(pos, color);
+Frame& Sprite::frameAt(int index) const{
+    StoredFrame& stored = frames.at(index);
+    stored.lastUsed = ++useClock;
+    if (!stored.frame.isNull())
+        return stored.frame;
+
+    // A delta continues from the chunk before it, which is usually the frame before and still decoded. Only
+    // a frame's own pixels are drawn on without leaving the source, so its layers are still as decoded.
+    const Header header = sourceHeader();
+    const FrameSource::Chunk& chunk = source->chunks.at(stored.chunk);
+    const StoredFrame* previous = index > 0 ? &frames[index - 1] : nullptr;
+    bool valid;
+    if (!chunk.keyframe && previous != nullptr && previous->chunk == stored.chunk - 1 && !previous->decoded.isNull()) {
+        stored.frame = previous->decoded;
+        stored.layers = previous->layers;
+        valid = decodeChunk(reinterpret_cast<const char*>(source->data) + chunk.offset, chunk.size, header, stored.frame, stored.layers);
+    } else {
+        valid = decodeSourceChunk(*source, header, stored.chunk, stored.frame, stored.layers);
+    }
+    if (!valid) {
+        // The file was only checked for where its chunks are when it was opened
+        qDebug() << "Frame" << index << "of the project is damaged";
+        stored.frame = indexed ? Frame(width, height, palette, palette.indexOf(qRgba(0, 0, 0, 0))) : Frame(width, height);
+        stored.layers = LayerStack();
+    }
+
+    // Frames of an animation mostly repeat the one before, so share the tiles which did not change
+    if (index > 0 && !frames[index - 1].frame.isNull())
+        stored.frame.shareIdenticalTiles(frames[index - 1].frame);
+    stored.decoded = stored.frame;
+    evictFrames(index);
+    return stored.frame;
 }
 
-QColor Sprite::getColor(QPoint pos){
-    return frames[currentFrameIndex].pixelColor(pos);
+void Sprite::evictFrames(int keep) const{
+    const qint64 frameBytes = qint64(width) * height * (indexed ? sizeof(quint8) : sizeof(QRgb));
+    while (true) {
+        qint64 cachedBytes = 0;
+        int oldest = -1;
+        for (int i = 0; i < int(frames.size()); i++) {
+            StoredFrame& stored = frames[i];
+            if (stored.chunk < 0 || stored.frame.isNull())
+                continue;
+            if (!stored.frame.sharesTiles(stored.decoded)) {
+                detachFrame(stored);
+                continue;
+            }
+            cachedBytes += frameBytes;
+            if (i != keep && i != currentFrameIndex && (oldest < 0 || stored.lastUsed < frames[oldest].lastUsed))
+                oldest = i;
+        }
+        if (cachedBytes <= FRAME_CACHE_BYTES || oldest < 0)
+            return;
+        frames[oldest].frame = Frame();
+        frames[oldest].decoded = Frame();
+        frames[oldest].layers = LayerStack();
+    }
+}
+
+void Sprite::detachFrame(StoredFrame& stored){
+    stored.chunk = -1;
+    stored.decoded = Frame();
+}
+
+LayerStack& Sprite::layerStack(int frameIndex){
+    frameAt(frameIndex);
+    StoredFrame& stored = frames.at(frameIndex);
+
+    // A frame's layers are only changed in memory, as the frame itself may not show the change
+    detachFrame(stored);
+    if (stored.layers.isEmpty())
+        stored.layers = LayerStack(QVector<Layer>{Layer{stored.frame}});
+    return stored.layers;
+}
+
+void Sprite::flattenLayers(int frameIndex){
+    StoredFrame& stored = frames.at(frameIndex);
+    if (stored.layers.count() == 1 && stored.layers.at(0).isPlain()) {
+        stored.frame = stored.layers.at(0).pixels;
+        stored.layers = LayerStack();
+        return;
+    }
+    stored.layers.flatten(stored.frame, stored.frame.getRect());
+}
+
+void Sprite::parallelFor(int count, const std::function<void(int index)>& task){
+    // Workers claim indices until none are left, so uneven tasks still keep every thread busy
+    QAtomicInt next = 0;
+    const auto work = [&]() {
+        for (int index = next.fetchAndAddRelaxed(1); index < count; index = next.fetchAndAddRelaxed(1))
+            task(index);
+    };
+
+    // Helpers which cannot start now are not waited for, as the calling thread does their share
+    QSemaphore finished;
+    int helpers = 0;
+    QThreadPool* pool = QThreadPool::globalInstance();
+    for (int i = 1; i < qMin(count, pool->maxThreadCount()); i++) {
+        if (!pool->tryStart([&]() { work(); finished.release(); }))
+            break;
+        helpers++;
+    }
+    work();
+    finished.acquire(helpers);
+}
+
+bool Sprite::isOpenedFrom(const QString& path) const{
+    return source && QFileInfo(source->file.fileName()) == QFileInfo(path);
+}
+
+void Sprite::detachSource(){
+    if (!source)
+        return;
+    for (int i = 0; i < int(frames.size()); i++) {
+        if (frames[i].chunk >= 0) {
+            frameAt(i);
+            detachFrame(frames[i]);
+        }
+    }
+    source.reset();
+}
+
+bool Sprite::contains(QPoint pos) const{
+    return pos.x() >= 0 && pos.x() < width && pos.y() >= 0 && pos.y() < height;
+}
+
+void Sprite::setPixel(QPoint pos, QRgb color){
+    if (contains(pos))
+        frameAt(currentFrameIndex).setPixel(pos.x(), pos.y(), color);
+}
+
+QRect Sprite::setPixels(const QVector<QPoint>& points, QRgb color){
+    Frame& currentFrame = frameAt(currentFrameIndex);
+    QRect changed;
+    for (const QPoint& pos : points) {
+        if (!contains(pos))
+            continue;
+        currentFrame.setPixel(pos.x(), pos.y(), color);
+        changed |= QRect(pos, QSize(1, 1));
+    }
+    return changed;
+}
+
+QRect Sprite::fillRect(QRect rect, QRgb color){
+    return frameAt(currentFrameIndex).fillRect(rect, color);
+}
+
+QRgb Sprite::getPixel(QPoint pos) const{
+    if (!contains(pos))
+        return qRgba(0, 0, 0, 0);
+    return frameAt(currentFrameIndex).getPixel(pos.x(), pos.y());
 }
 
 void Sprite::addFrame(){
-    QImage image(width, width, QImage::Format_ARGB32);
-    image.fill(QColor(0,0,0,0));
-    frames.push_back(image);
+    StoredFrame stored;
+    if (isIndexed())
+        stored.frame = Frame(width, height, palette, palette.indexOf(qRgba(0, 0, 0, 0)));
+    else
+        stored.frame = Frame(width, height, qRgba(0, 0, 0, 0));
+    frames.push_back(stored);
 }
 
-QImage& Sprite::getFrame(){
-    return frames[currentFrameIndex];
+Frame& Sprite::getFrame(){
+    return frameAt(currentFrameIndex);
 }
 
-QImage& Sprite::getFrame(int frame, bool setCurrent = false){
+Frame& Sprite::getFrame(int frame, bool setCurrent = false){
     try {
-        QImage& result = frames.at(frame);
-        if (setCurrent)
+        Frame& result = frameAt(frame);
+        if (setCurrent && frame != currentFrameIndex) {
+            // Only the current frame is drawn on, so the composites kept for drawing on the last one can go
+            if (currentFrameIndex < int(frames.size()))
+                frames[currentFrameIndex].layers.dropCache();
             currentFrameIndex = frame;
+        }
         return result;
     } catch(const std::out_of_range& e) {
         throw;
     }
 }
 
+int Sprite::getCurrentFrameIndex(){
+    return currentFrameIndex;
+}
+
+void Sprite::insertFrame(int index, const Frame& frame){
+    // Frames restored from the history may predate a change of format or palette
+    StoredFrame stored;
+    if (isIndexed() && (!frame.isIndexed() || frame.getPalette() != palette))
+        stored.frame = frame.toIndexed(palette);
+    else if (!isIndexed() && frame.isIndexed())
+        stored.frame = frame.toArgb();
+    else
+        stored.frame = frame;
+    frames.insert(frames.begin() + index, stored);
+}
+
+void Sprite::insertFrame(int index, const QVector<Layer>& layers){
+    // An indexed sprite has no layers, so a layered frame restored into one is flattened onto its palette
+    if (isIndexed()) {
+        Frame flattened(width, height);
+        LayerStack(layers).flatten(flattened, flattened.getRect());
+        insertFrame(index, flattened);
+        return;
+    }
+
+    StoredFrame stored;
+    stored.frame = Frame(width, height);
+    stored.layers = LayerStack(layers);
+    frames.insert(frames.begin() + index, stored);
+    flattenLayers(index);
+}
+
 void Sprite::deleteFrame(){
     frames.erase(frames.begin() + currentFrameIndex);
     if (currentFrameIndex != 0)
@@ -66,68 +302,732 @@ void Sprite::deleteFrame(int frame){
 void Sprite::duplicateFrame(int frameIndex)
 {
 
-    QImage copy = frames[frameIndex].copy();
+    // Copying a frame only copies its tile pointers, the tiles themselves are cloned when next drawn on. A
+    // frame which is not decoded yet is copied as where it is stored.
+    StoredFrame copy = frames[frameIndex];
 
     frames.insert(frames.begin() + frameIndex + 1, copy);
 }
 
+int Sprite::getLayerCount(int frameIndex) const{
+    frameAt(frameIndex);
+    return qMax(1, frames.at(frameIndex).layers.count());
+}
+
+Layer Sprite::getLayer(int frameIndex, int layerIndex) const{
+    const Frame& frame = frameAt(frameIndex);
+    const LayerStack& layers = frames.at(frameIndex).layers;
+    if (layers.isEmpty())
+        return Layer{frame};
+    return layers.at(layerIndex);
+}
+
+QVector<Layer> Sprite::getLayers(int frameIndex) const{
+    frameAt(frameIndex);
+    return frames.at(frameIndex).layers.getLayers();
+}
+
+Frame& Sprite::getLayerPixels(int frameIndex, int layerIndex){
+    Frame& frame = frameAt(frameIndex);
+    StoredFrame& stored = frames.at(frameIndex);
+    if (stored.layers.isEmpty())
+        return frame;
+    detachFrame(stored);
+    return stored.layers.pixels(layerIndex);
+}
+
+QRect Sprite::layerEdited(int frameIndex, int layerIndex, QRect dirtyRect){
+    StoredFrame& stored = frames.at(frameIndex);
+    if (!stored.layers.isEmpty())
+        stored.layers.flatten(stored.frame, dirtyRect, layerIndex);
+    return dirtyRect & stored.frame.getRect();
+}
+
+bool Sprite::addLayer(int frameIndex, int layerIndex){
+    if (isIndexed() || getLayerCount(frameIndex) >= LayerStack::MAX_LAYERS)
+        return false;
+
+    // A transparent layer changes nothing, whatever its place, until it is drawn on
+    layerStack(frameIndex).insert(layerIndex, Layer{Frame(width, height)});
+    return true;
+}
+
+bool Sprite::insertLayer(int frameIndex, int layerIndex, const Layer& layer){
+    if (isIndexed() || getLayerCount(frameIndex) >= LayerStack::MAX_LAYERS)
+        return false;
+    layerStack(frameIndex).insert(layerIndex, layer);
+    flattenLayers(frameIndex);
+    return true;
+}
+
+void Sprite::deleteLayer(int frameIndex, int layerIndex){
+    if (getLayerCount(frameIndex) <= 1)
+        return;
+    layerStack(frameIndex).remove(layerIndex);
+    flattenLayers(frameIndex);
+}
+
+void Sprite::setLayerProperties(int frameIndex, int layerIndex, bool visible, quint8 opacity, BlendMode mode){
+    layerStack(frameIndex).setProperties(layerIndex, visible, opacity, mode);
+    flattenLayers(frameIndex);
+}
+
+QVector<Sprite::FrameEdit> Sprite::updateFrames(int firstFrame, int lastFrame, const std::function<bool(QVector<Layer>& layers)>& update){
+    const int count = lastFrame - firstFrame + 1;
+    QVector<StoredFrame> results(count);
+    QVector<FrameEdit> edits(count);
+    QVector<int> runs;
+    QVector<bool> continuesRun(count, false);
+    for (int i = 0; i < count; i++) {
+        const StoredFrame& stored = frames.at(firstFrame + i);
+        results[i].frame = stored.frame;
+        results[i].layers = stored.layers;
+        results[i].chunk = stored.chunk;
+        edits[i].frameIndex = firstFrame + i;
+        if (!stored.frame.isNull())
+            continue;
+
+        // A delta is decoded on top of the chunk before it, so such frames are decoded in runs
+        continuesRun[i] = i > 0 && results.at(i - 1).frame.isNull() && results.at(i - 1).chunk == stored.chunk - 1
+                          && !source->chunks.at(stored.chunk).keyframe;
+        if (!continuesRun.at(i))
+            runs.append(i);
+    }
+
+    const Header header = sourceHeader();
+    parallelFor(runs.size(), [&](int run) {
+        // Only this worker touches the results of its run, and the mapped file is read only
+        bool valid = false;
+        for (int i = runs.at(run); i == runs.at(run) || (i < count && continuesRun.at(i)); i++) {
+            StoredFrame& result = results[i];
+            if (i == runs.at(run)) {
+                valid = decodeSourceChunk(*source, header, result.chunk, result.frame, result.layers);
+            } else if (valid) {
+                const FrameSource::Chunk& chunk = source->chunks.at(result.chunk);
+                result.frame = results.at(i - 1).frame;
+                result.layers = results.at(i - 1).layers;
+                valid = decodeChunk(reinterpret_cast<const char*>(source->data) + chunk.offset, chunk.size, header, result.frame, result.layers);
+            }
+            if (!valid) {
+                qDebug() << "Frame" << firstFrame + i << "of the project is damaged";
+                result.frame = indexed ? Frame(width, height, palette, palette.indexOf(qRgba(0, 0, 0, 0))) : Frame(width, height);
+                result.layers = LayerStack();
+            }
+        }
+    });
+
+    // Decoded deltas share their unchanged tiles, so repeated frames are found even if they were not in memory
+    QVector<bool> repeated(count, false);
+    for (int i = 1; i < count; i++) {
+        repeated[i] = results.at(i).layers.isEmpty() && results.at(i - 1).layers.isEmpty()
+                      && results.at(i).frame.sharesTiles(results.at(i - 1).frame);
+    }
+
+    parallelFor(count, [&](int i) {
+        if (repeated.at(i))
+            return;
+
+        StoredFrame& result = results[i];
+        FrameEdit& edit = edits[i];
+        edit.before = result.layers.isEmpty() ? QVector<Layer>{Layer{result.frame}} : result.layers.getLayers();
+        QVector<Layer> layers = edit.before;
+        if (!update(layers))
+            return;
+        edit.after = layers;
+        if (result.layers.isEmpty()) {
+            result.frame = layers.first().pixels;
+            return;
+        }
+        result.layers = LayerStack(layers);
+        result.frame = Frame(width, height);
+        result.layers.flatten(result.frame, result.frame.getRect());
+    });
+
+    // The updated frames replace their sources, so they now live only in memory
+    QVector<FrameEdit> changed;
+    for (int i = 0; i < count; i++) {
+        if (repeated.at(i)) {
+            results[i] = results.at(i - 1);
+            edits[i].before = edits.at(i - 1).before;
+            edits[i].after = edits.at(i - 1).after;
+        }
+        if (edits.at(i).after.isEmpty())
+            continue;
+        StoredFrame& stored = frames[firstFrame + i];
+        stored.frame = results.at(i).frame;
+        stored.layers = results.at(i).layers;
+        detachFrame(stored);
+        changed.append(edits.at(i));
+    }
+    return changed;
+}
+
+bool Sprite::transformFrames(int firstFrame, int lastFrame, const FrameTransform& transform){
+    if (transform.swapsSize() && width != height)
+        return false;
+    if (transform.isRecolor() && indexed) {
+        for (int i = 0; i < palette.size(); i++)
+            setPaletteColor(i, FrameTransform::invert(palette.color(i)));
+        return true;
+    }
+
+    updateFrames(firstFrame, lastFrame, [&](QVector<Layer>& layers) {
+        for (Layer& layer : layers)
+            layer.pixels = transform.apply(layer.pixels);
+        return true;
+    });
+    return true;
+}
+
+QVector<Sprite::FrameEdit> Sprite::replaceColor(int firstFrame, int lastFrame, QRgb from, QRgb to, int tolerance){
+    return updateFrames(firstFrame, lastFrame, [&](QVector<Layer>& layers) {
+        bool changed = false;
+        for (Layer& layer : layers)
+            changed = Recolor::replace(layer.pixels, from, to, tolerance) || changed;
+        return changed;
+    });
+}
+
 int Sprite::getWidth() {
     return width;
 }
 
+int Sprite::getHeight() {
+    return height;
+}
+
 int Sprite::getFrameCount(){
     return frames.size();
 }
 
-QString Sprite::Serialize() {
-    QJsonArray framesArray;
-    for (QImage& image : frames) {
-        QJsonArray jsonColors;
-        for (int i = 0; i < width; i++) {
-            for (int j = 0; j < width; j++) {
-                QColor colorToSerialize = image.pixelColor(QPoint(i,j));
-                QJsonObject colorInfo;
+bool Sprite::isIndexed() const{
+    return indexed;
+}
+
+const Palette& Sprite::getPalette() const{
+    return palette;
+}
 
-                colorInfo["red"] = colorToSerialize.red();
-                colorInfo["green"] = colorToSerialize.green();
-                colorInfo["blue"] = colorToSerialize.blue();
-                colorInfo["alpha"] = colorToSerialize.alpha();
+bool Sprite::convertToIndexed(QString& error){
+    if (isIndexed())
+        return true;
 
-                jsonColors.append(colorInfo);
+    // Frames are decoded one at a time, so finding the colors of an opened project stays within the cache
+    QVector<QRgb> colors{qRgba(0, 0, 0, 0)};
+    QSet<QRgb> seen{qRgba(0, 0, 0, 0)};
+    QVector<QRgb> row(width);
+    for (int i = 0; i < int(frames.size()); i++) {
+        const Frame& frame = frameAt(i);
+        if (!frames[i].layers.isEmpty()) {
+            error = "Frame " + QString::number(i + 1) + " has layers. Indexed sprites have one layer per frame, "
+                    "so delete the other layers first.";
+            return false;
+        }
+        for (int y = 0; y < height; y++) {
+            frame.readRow(0, y, width, row.data());
+            for (QRgb color : row) {
+                if (seen.contains(color))
+                    continue;
+                if (colors.size() == Palette::MAX_COLORS) {
+                    error = "The sprite uses more than " + QString::number(Palette::MAX_COLORS) + " colors.";
+                    return false;
+                }
+                seen.insert(color);
+                colors.append(color);
             }
         }
-        framesArray.append(jsonColors);
     }
 
-    QJsonDocument doc(framesArray);
-    return doc.toJson(QJsonDocument::Indented);
+    const Palette newPalette(colors);
+    for (int i = 0; i < int(frames.size()); i++) {
+        const Frame indexedFrame = frameAt(i).toIndexed(newPalette);
+        detachFrame(frames[i]);
+        frames[i].frame = indexedFrame;
+        if (i > 0)
+            frames[i].frame.shareIdenticalTiles(frames[i - 1].frame);
+    }
+    indexed = true;
+    palette = newPalette;
+    source.reset();
+    return true;
 }
 
-Sprite* Sprite::Deserialize(const QByteArray& jsonData){
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-    if (doc.isNull() || !doc.isArray()) {
+void Sprite::convertToRgb(){
+    if (!isIndexed())
+        return;
+    for (int i = 0; i < int(frames.size()); i++) {
+        const Frame argbFrame = frameAt(i).toArgb();
+        detachFrame(frames[i]);
+        frames[i].frame = argbFrame;
+        if (i > 0)
+            frames[i].frame.shareIdenticalTiles(frames[i - 1].frame);
+    }
+    indexed = false;
+    palette = Palette();
+    source.reset();
+}
+
+void Sprite::setPaletteColor(int index, QRgb color){
+    palette.setColor(index, color);
+
+    // Every frame gets a copy of the same palette, which shares its table with the others. Frames which are
+    // not decoded yet pick it up when they are.
+    for (StoredFrame& stored : frames) {
+        if (!stored.frame.isNull())
+            stored.frame.setPalette(palette);
+        if (!stored.decoded.isNull())
+            stored.decoded.setPalette(palette);
+    }
+}
+
+bool Sprite::Serialize(QIODevice& device, bool compress) {
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    // Frames not decoded yet can only have layers if the file they come from does
+    bool layered = source && (source->flags & FLAG_LAYERS);
+    for (const StoredFrame& stored : frames)
+        layered = layered || !stored.layers.isEmpty();
+    const quint16 flags = FLAG_DELTA | (compress ? FLAG_COMPRESSED : 0) | (indexed ? FLAG_INDEXED : 0) | (layered ? FLAG_LAYERS : 0);
+    const quint16 chunkFlags = FLAG_DELTA | FLAG_COMPRESSED | FLAG_LAYERS;
+
+    stream << FILE_MAGIC << FILE_VERSION << flags;
+    stream << qint32(width) << qint32(height) << qint32(frames.size());
+
+    if (indexed) {
+        stream << quint16(palette.size());
+        for (int i = 0; i < palette.size(); i++)
+            stream << quint32(palette.color(i));
+    }
+
+    // A keyframe holds each layer's rows top to bottom as little endian ARGB32 words, or as palette indices,
+    // and a delta only the tiles which differ from the same layer of the frame before
+    QByteArray raw;
+    raw.reserve(qsizetype(width) * height * (indexed ? sizeof(quint8) : sizeof(QRgb)));
+    QVector<QRgb> scratch(qsizetype(width) * height);
+    int sinceKeyframe = 0;
+    bool copiedPrevious = false;
+    for (int i = 0; i < int(frames.size()); i++) {
+        // An unchanged frame's chunk can be copied as it is, as long as it is compressed the same way and,
+        // for a delta, the chunk it continues from was copied just before it
+        const StoredFrame& stored = frames[i];
+        if (stored.chunk >= 0 && (source->flags & chunkFlags) == (flags & chunkFlags)
+            && (stored.frame.isNull() || stored.frame.sharesTiles(stored.decoded))) {
+            const FrameSource::Chunk& chunk = source->chunks.at(stored.chunk);
+            if (chunk.keyframe || (copiedPrevious && frames[i - 1].chunk == stored.chunk - 1)) {
+                stream << chunk.size;
+                stream.writeRawData(reinterpret_cast<const char*>(source->data) + chunk.offset, chunk.size);
+                sinceKeyframe = chunk.keyframe ? 0 : sinceKeyframe + 1;
+                copiedPrevious = true;
+                continue;
+            }
+        }
+        copiedPrevious = false;
+
+        // The frame before is taken first, as decoding this one may drop it from the cache. A frame before
+        // which is not in memory was copied from the source, so this one becomes a keyframe.
+        const Frame previous = i > 0 ? frames[i - 1].frame : Frame();
+        const LayerStack previousStack = i > 0 ? frames[i - 1].layers : LayerStack();
+        const Frame& frame = frameAt(i);
+
+        // A frame without layers of its own is written as a single plain layer
+        const QVector<Layer> layers = frames[i].layers.isEmpty() ? QVector<Layer>{Layer{frame}} : frames[i].layers.getLayers();
+        const QVector<Layer> previousLayers = previous.isNull() ? QVector<Layer>()
+            : previousStack.isEmpty() ? QVector<Layer>{Layer{previous}} : previousStack.getLayers();
+
+        QVector<QVector<quint32>> changedTiles(layers.size());
+        bool delta = sinceKeyframe + 1 < KEYFRAME_INTERVAL && previousLayers.size() == layers.size();
+        if (delta) {
+            qsizetype changedCount = 0;
+            for (int layer = 0; layer < layers.size(); layer++) {
+                const Frame& pixels = layers[layer].pixels;
+                for (int row = 0; row < pixels.getTileRows(); row++) {
+                    for (int column = 0; column < pixels.getTileColumns(); column++) {
+                        if (!pixels.tileEquals(previousLayers[layer].pixels, column, row))
+                            changedTiles[layer].append(quint32(row * pixels.getTileColumns() + column));
+                    }
+                }
+                changedCount += changedTiles[layer].size();
+            }
+            // A delta changing every tile is no smaller than a keyframe
+            delta = changedCount < qsizetype(layers.size()) * frame.getTileColumns() * frame.getTileRows();
+        }
+
+        raw.clear();
+        if (layered) {
+            raw.append(char(layers.size()));
+            for (const Layer& layer : layers) {
+                raw.append(char(layer.visible));
+                raw.append(char(layer.opacity));
+                raw.append(char(layer.mode));
+            }
+        }
+        for (int layer = 0; layer < layers.size(); layer++) {
+            const Frame& pixels = layers[layer].pixels;
+            if (!delta) {
+                appendPixels(raw, pixels, pixels.getRect(), scratch);
+                continue;
+            }
+            appendWord(raw, changedTiles[layer].size());
+            for (quint32 tile : changedTiles[layer])
+                appendWord(raw, tile);
+            for (quint32 tile : changedTiles[layer])
+                appendPixels(raw, pixels, pixels.tileRect(tile % pixels.getTileColumns(), tile / pixels.getTileColumns()), scratch);
+        }
+
+        // The kind is left uncompressed, so opening a project can tell keyframes apart without decoding
+        const QByteArray chunk = compress ? qCompress(raw) : raw;
+        stream << quint32(1 + chunk.size()) << (delta ? CHUNK_DELTA : CHUNK_KEYFRAME);
+        stream.writeRawData(chunk.constData(), chunk.size());
+        sinceKeyframe = delta ? sinceKeyframe + 1 : 0;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+Sprite* Sprite::Open(const QString& path, const ProgressCallback& progress){
+    std::shared_ptr<FrameSource> source = std::make_shared<FrameSource>();
+    source->file.setFileName(path);
+    if (!source->file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open file for reading:" << source->file.errorString();
         return nullptr;
     }
-    QJsonArray framesArray = doc.array();
-    int jsonWidth = sqrt(int(framesArray[0].toArray().count()));
-    Sprite* newSprite = new Sprite(jsonWidth);
+
+    QDataStream stream(&source->file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0;
+    stream >> magic;
+    source->size = source->file.size();
+    source->data = source->file.map(0, source->size);
+    if (stream.status() != QDataStream::Ok || magic != FILE_MAGIC || source->data == nullptr) {
+        if (!source->file.seek(0))
+            return nullptr;
+        return Deserialize(source->file, progress);
+    }
+
+    Header header;
+    if (!readHeader(stream, header))
+        return nullptr;
+    source->flags = header.flags;
+
+    // Only record where each chunk is and if it is a keyframe, which reads a few bytes per frame
+    Sprite* newSprite = new Sprite(header.width, header.height);
     newSprite->frames = {};
+    newSprite->frames.reserve(header.frameCount);
+    newSprite->indexed = header.flags & FLAG_INDEXED;
+    newSprite->palette = header.palette;
+    qint64 offset = source->file.pos();
+    for (int i = 0; i < header.frameCount; i++) {
+        if (source->size - offset < qint64(sizeof(quint32))) {
+            delete newSprite;
+            return nullptr;
+        }
+        FrameSource::Chunk chunk;
+        chunk.size = qFromBigEndian<quint32>(source->data + offset);
+        chunk.offset = offset + sizeof(quint32);
+        if (chunk.size > source->size - chunk.offset) {
+            delete newSprite;
+            return nullptr;
+        }
+        chunk.keyframe = !(header.flags & FLAG_DELTA) || (chunk.size > 0 && source->data[chunk.offset] == CHUNK_KEYFRAME);
+        offset = chunk.offset + chunk.size;
+        source->chunks.append(chunk);
 
-    for (int x = 0; x < framesArray.size(); x++) {
-        QJsonValue frameVal = framesArray[x];
-        QJsonArray frame = frameVal.toArray();
-        newSprite->addFrame();
-        newSprite->currentFrameIndex = x;
+        StoredFrame stored;
+        stored.chunk = i;
+        newSprite->frames.push_back(stored);
+    }
+    newSprite->source = source;
+    if (progress)
+        progress(100);
 
-        for (int i = 0; i < frame.count(); i++) {
-            QJsonObject colorObj = frame[i].toObject();
-            QColor color(colorObj["red"].toInt(), colorObj["green"].toInt(), colorObj["blue"].toInt(), colorObj["alpha"].toInt());
-            newSprite->setPixel(QPoint(i/jsonWidth, i%jsonWidth), color);
+    return newSprite;
+}
+
+Sprite* Sprite::Deserialize(QIODevice& device, const ProgressCallback& progress){
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    stream >> magic;
+    if (stream.status() == QDataStream::Ok && magic == FILE_MAGIC)
+        return DeserializeBinary(stream, progress);
+
+    // Not a v2 project, so rewind and import it as legacy JSON
+    if (!device.seek(0))
+        return nullptr;
+    return DeserializeJson(device, progress);
+}
+
+bool Sprite::readHeader(QDataStream& stream, Header& header){
+    quint16 version;
+    qint32 fileWidth, fileHeight, frameCount;
+    stream >> version >> header.flags >> fileWidth >> fileHeight >> frameCount;
+    if (stream.status() != QDataStream::Ok || version != FILE_VERSION)
+        return false;
+    if (fileWidth < 1 || fileWidth > MAX_SIZE || fileHeight < 1 || fileHeight > MAX_SIZE || frameCount < 1)
+        return false;
+    if ((header.flags & FLAG_INDEXED) && (header.flags & FLAG_LAYERS))
+        return false;
+    header.width = fileWidth;
+    header.height = fileHeight;
+    header.frameCount = frameCount;
+
+    if (header.flags & FLAG_INDEXED) {
+        quint16 paletteSize = 0;
+        stream >> paletteSize;
+        if (stream.status() != QDataStream::Ok || paletteSize < 1 || paletteSize > Palette::MAX_COLORS)
+            return false;
+        QVector<QRgb> colors(paletteSize);
+        for (QRgb& color : colors) {
+            quint32 value = 0;
+            stream >> value;
+            color = value;
         }
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        header.palette = Palette(colors);
+    }
+    return true;
+}
+
+bool Sprite::decodeChunk(const char* data, qsizetype size, const Header& header, Frame& frame, LayerStack& layers){
+    const bool indexed = header.flags & FLAG_INDEXED;
+    const qsizetype rowBytes = qsizetype(header.width) * (indexed ? sizeof(quint8) : sizeof(QRgb));
+    bool delta = false;
+    if (header.flags & FLAG_DELTA) {
+        if (size < 1 || quint8(data[0]) > CHUNK_DELTA)
+            return false;
+        delta = quint8(data[0]) == CHUNK_DELTA;
+        data++;
+        size--;
     }
+    QByteArray chunk = header.flags & FLAG_COMPRESSED
+        ? qUncompress(reinterpret_cast<const uchar*>(data), size)
+        : QByteArray(data, size);
+    if (delta)
+        return decodeDelta(chunk, header, frame, layers);
+    layers = LayerStack();
+
+    if (header.flags & FLAG_LAYERS) {
+        const qsizetype layerBytes = rowBytes * header.height;
+        const int count = chunk.isEmpty() ? 0 : quint8(chunk.at(0));
+        if (count < 1 || count > LayerStack::MAX_LAYERS || chunk.size() != 1 + 3 * count + count * layerBytes)
+            return false;
 
-    newSprite->currentFrameIndex = 0;
+        const uchar* properties = reinterpret_cast<const uchar*>(chunk.constData()) + 1;
+        const uchar* layerData = properties + 3 * count;
+        QVector<Layer> decoded(count);
+        QVector<QRgb> pixels(qsizetype(header.width) * header.height);
+        for (int i = 0; i < count; i++) {
+            Layer& layer = decoded[i];
+            if (properties[3 * i + 2] > quint8(BlendMode::REPLACE))
+                return false;
+            layer.visible = properties[3 * i];
+            layer.opacity = properties[3 * i + 1];
+            layer.mode = BlendMode(properties[3 * i + 2]);
+            qFromLittleEndian<quint32>(layerData + i * layerBytes, pixels.size(), pixels.data());
+            layer.pixels = Frame(header.width, header.height);
+            layer.pixels.writeRect(layer.pixels.getRect(), pixels.constData());
+        }
+
+        if (count == 1 && decoded.first().isPlain()) {
+            frame = decoded.first().pixels;
+        } else {
+            layers = LayerStack(decoded);
+            frame = Frame(header.width, header.height);
+            layers.flatten(frame, frame.getRect());
+        }
+        return true;
+    }
+
+    if (chunk.size() != rowBytes * header.height)
+        return false;
+
+    if (indexed) {
+        frame = Frame(header.width, header.height, header.palette, 0);
+        frame.writeIndices(frame.getRect(), reinterpret_cast<const quint8*>(chunk.constData()));
+    } else {
+        QRgb* pixels = reinterpret_cast<QRgb*>(chunk.data());
+        qFromLittleEndian<quint32>(pixels, qsizetype(header.width) * header.height, pixels);
+        frame = Frame(header.width, header.height);
+        frame.writeRect(frame.getRect(), pixels);
+    }
+    return true;
+}
+
+bool Sprite::decodeDelta(const QByteArray& chunk, const Header& header, Frame& frame, LayerStack& layers){
+    if (frame.isNull() || frame.getWidth() != header.width || frame.getHeight() != header.height)
+        return false;
+
+    // Only the changed tiles are written, so the rest stay shared with the frame before
+    QVector<Layer> decoded = layers.isEmpty() ? QVector<Layer>{Layer{frame}} : layers.getLayers();
+    const uchar* in = reinterpret_cast<const uchar*>(chunk.constData());
+    const uchar* end = in + chunk.size();
+    bool propertiesChanged = false;
+    if (header.flags & FLAG_LAYERS) {
+        if (end - in < 1 || *in != decoded.size() || end - in < 1 + 3 * decoded.size())
+            return false;
+        in++;
+        for (Layer& layer : decoded) {
+            if (in[2] > quint8(BlendMode::REPLACE))
+                return false;
+            propertiesChanged = propertiesChanged || layer.visible != bool(in[0]) || layer.opacity != in[1] || layer.mode != BlendMode(in[2]);
+            layer.visible = in[0];
+            layer.opacity = in[1];
+            layer.mode = BlendMode(in[2]);
+            in += 3;
+        }
+    } else if (decoded.size() != 1) {
+        return false;
+    }
+
+    const int columns = frame.getTileColumns();
+    const quint32 tileCount = quint32(columns * frame.getTileRows());
+    const int pixelBytes = header.flags & FLAG_INDEXED ? sizeof(quint8) : sizeof(QRgb);
+    QVector<QRgb> pixels(Frame::TILE_SIZE * Frame::TILE_SIZE);
+    QRect changed;
+    for (Layer& layer : decoded) {
+        if (end - in < qsizetype(sizeof(quint32)))
+            return false;
+        const quint32 count = qFromLittleEndian<quint32>(in);
+        in += sizeof(quint32);
+        if (count > tileCount || end - in < qsizetype(count) * qsizetype(sizeof(quint32)))
+            return false;
+        const uchar* tiles = in;
+        in += count * sizeof(quint32);
+        for (quint32 i = 0; i < count; i++) {
+            const quint32 tile = qFromLittleEndian<quint32>(tiles + i * sizeof(quint32));
+            if (tile >= tileCount)
+                return false;
+            const QRect rect = layer.pixels.tileRect(tile % columns, tile / columns);
+            const qsizetype pixelCount = qsizetype(rect.width()) * rect.height();
+            if (end - in < pixelCount * pixelBytes)
+                return false;
+            if (header.flags & FLAG_INDEXED) {
+                layer.pixels.writeIndices(rect, in);
+            } else {
+                qFromLittleEndian<quint32>(in, pixelCount, pixels.data());
+                layer.pixels.writeRect(rect, pixels.constData());
+            }
+            in += pixelCount * pixelBytes;
+            changed |= rect;
+        }
+    }
+    if (in != end)
+        return false;
+
+    if (decoded.size() == 1 && decoded.first().isPlain()) {
+        frame = decoded.first().pixels;
+        layers = LayerStack();
+        return true;
+    }
+
+    // The frame before is already flattened, so only what changed is composited again
+    const bool wasFlattened = !layers.isEmpty();
+    layers = LayerStack(decoded);
+    if (!wasFlattened || propertiesChanged)
+        changed = frame.getRect();
+    if (!changed.isEmpty())
+        layers.flatten(frame, changed);
+    return true;
+}
+
+bool Sprite::decodeSourceChunk(const FrameSource& source, const Header& header, int chunk, Frame& frame, LayerStack& layers){
+    int keyframe = chunk;
+    while (keyframe > 0 && !source.chunks.at(keyframe).keyframe)
+        keyframe--;
+
+    frame = Frame();
+    layers = LayerStack();
+    for (int i = keyframe; i <= chunk; i++) {
+        const FrameSource::Chunk& stored = source.chunks.at(i);
+        if (!decodeChunk(reinterpret_cast<const char*>(source.data) + stored.offset, stored.size, header, frame, layers))
+            return false;
+    }
+    return true;
+}
+
+Sprite::Header Sprite::sourceHeader() const{
+    Header header;
+    header.flags = source ? source->flags : 0;
+    header.width = width;
+    header.height = height;
+    header.palette = palette;
+    return header;
+}
+
+Sprite* Sprite::DeserializeBinary(QDataStream& stream, const ProgressCallback& progress){
+    Header header;
+    if (!readHeader(stream, header))
+        return nullptr;
+
+    Sprite* newSprite = new Sprite(header.width, header.height);
+    newSprite->frames = {};
+    newSprite->frames.reserve(header.frameCount);
+    newSprite->indexed = header.flags & FLAG_INDEXED;
+    newSprite->palette = header.palette;
+
+    for (int x = 0; x < header.frameCount; x++) {
+        quint32 chunkSize = 0;
+        stream >> chunkSize;
+        if (stream.status() != QDataStream::Ok || chunkSize > stream.device()->bytesAvailable()) {
+            delete newSprite;
+            return nullptr;
+        }
+
+        QByteArray chunk(chunkSize, Qt::Uninitialized);
+        stream.readRawData(chunk.data(), chunkSize);
+
+        // A delta chunk is decoded on top of the frame before it
+        StoredFrame stored;
+        if (!newSprite->frames.empty()) {
+            stored.frame = newSprite->frames.back().frame;
+            stored.layers = newSprite->frames.back().layers;
+        }
+        if (stream.status() != QDataStream::Ok || !decodeChunk(chunk.constData(), chunk.size(), header, stored.frame, stored.layers)) {
+            delete newSprite;
+            return nullptr;
+        }
+
+        // Frames of an animation mostly repeat the one before, so share the tiles which did not change
+        if (!newSprite->frames.empty())
+            stored.frame.shareIdenticalTiles(newSprite->frames.back().frame);
+        newSprite->frames.push_back(stored);
+
+        if (progress)
+            progress((x + 1) * 100 / header.frameCount);
+    }
 
     return newSprite;
 }
 
+Sprite* Sprite::DeserializeJson(QIODevice& device, const ProgressCallback& progress){
+    LegacyProjectReader reader(device);
+    if (!reader.readHeader()) {
+        qDebug() << "Invalid legacy project:" << reader.errorString();
+        return nullptr;
+    }
+
+    Sprite* newSprite = new Sprite(reader.getWidth(), reader.getWidth());
+    newSprite->frames = {};
+
+    QImage image;
+    while (reader.readFrame(image)) {
+        StoredFrame stored;
+        stored.frame = Frame(image);
+        if (!newSprite->frames.empty())
+            stored.frame.shareIdenticalTiles(newSprite->frames.back().frame);
+        newSprite->frames.push_back(stored);
+        if (progress)
+            progress(reader.progress());
+    }
+
+    if (reader.hasError()) {
+        qDebug() << "Invalid legacy project:" << reader.errorString();
+        delete newSprite;
+        return nullptr;
+    }
+
+    return newSprite;
+}
@@ -0,0 +1,157 @@
+/**
+ * Whole-frame transforms, such as flips, rotations and shifts, applied to many frames of an animation at
+ * once. Each transform has an exact inverse, so undoing one only needs the transform rather than the pixels
+ * it replaced. The kernels work a strip of tile rows at a time, so every tile of the source and destination
+ * is read and written once whatever the transform.
+ *
+ * Created by [redacted], [redacted], [redacted], bananathrowingmachine, and [redacted]
+ * October 16, 2026
+ **/
+
+#include "transform.h"
+#include <algorithm>
+
+// The kernels are written once for both ARGB32 pixels and palette indices
+static void readPixels(const Frame& frame, QRect rect, QRgb* out){
+    frame.readRect(rect, out);
+}
+
+static void readPixels(const Frame& frame, QRect rect, quint8* out){
+    frame.readIndices(rect, out);
+}
+
+static void writePixels(Frame& frame, QRect rect, const QRgb* in){
+    frame.writeRect(rect, in);
+}
+
+static void writePixels(Frame& frame, QRect rect, const quint8* in){
+    frame.writeIndices(rect, in);
+}
+
+/**
+ * Returns value modulo divisor, never negative.
+ */
+static int wrap(int value, int divisor){
+    return ((value % divisor) + divisor) % divisor;
+}
+
+FrameTransform::FrameTransform(TransformType type, int dx, int dy) : type{type}, dx{dx}, dy{dy} {}
+
+TransformType FrameTransform::getType() const{
+    return type;
+}
+
+int FrameTransform::getDx() const{
+    return dx;
+}
+
+int FrameTransform::getDy() const{
+    return dy;
+}
+
+FrameTransform FrameTransform::inverse() const{
+    switch (type) {
+    case TransformType::ROTATE_CLOCKWISE:
+        return FrameTransform(TransformType::ROTATE_COUNTERCLOCKWISE);
+    case TransformType::ROTATE_COUNTERCLOCKWISE:
+        return FrameTransform(TransformType::ROTATE_CLOCKWISE);
+    case TransformType::SHIFT:
+        return FrameTransform(TransformType::SHIFT, -dx, -dy);
+    default:
+        // Flips, half turns and inverting colors undo themselves
+        return *this;
+    }
+}
+
+bool FrameTransform::swapsSize() const{
+    return type == TransformType::ROTATE_CLOCKWISE || type == TransformType::ROTATE_COUNTERCLOCKWISE;
+}
+
+bool FrameTransform::isRecolor() const{
+    return type == TransformType::INVERT_COLORS;
+}
+
+QRgb FrameTransform::invert(QRgb color){
+    return color ^ 0x00ffffff;
+}
+
+Frame FrameTransform::apply(const Frame& frame) const{
+    if (frame.isNull() || (isRecolor() && frame.isIndexed()))
+        return frame;
+
+    const int width = swapsSize() ? frame.getHeight() : frame.getWidth();
+    const int height = swapsSize() ? frame.getWidth() : frame.getHeight();
+    if (frame.isIndexed()) {
+        Frame transformed(width, height, frame.getPalette(), 0);
+        transformPixels<quint8>(frame, transformed);
+        return transformed;
+    }
+    Frame transformed(width, height);
+    transformPixels<QRgb>(frame, transformed);
+    return transformed;
+}
+
+template <typename T>
+void FrameTransform::transformPixels(const Frame& source, Frame& destination) const{
+    const int width = source.getWidth();
+    const int height = source.getHeight();
+    QVector<T> strip(qsizetype(width) * Frame::TILE_SIZE);
+    QVector<T> out(qsizetype(width) * Frame::TILE_SIZE);
+
+    for (int top = 0; top < height; top += Frame::TILE_SIZE) {
+        const int rows = qMin(int(Frame::TILE_SIZE), height - top);
+        readPixels(source, QRect(0, top, width, rows), strip.data());
+        const T* in = strip.constData();
+
+        switch (type) {
+        case TransformType::FLIP_HORIZONTAL:
+            for (int row = 0; row < rows; row++)
+                std::reverse_copy(in + row * width, in + (row + 1) * width, out.data() + row * width);
+            writePixels(destination, QRect(0, top, width, rows), out.constData());
+            break;
+        case TransformType::FLIP_VERTICAL:
+            for (int row = 0; row < rows; row++)
+                std::copy(in + row * width, in + (row + 1) * width, out.data() + (rows - 1 - row) * width);
+            writePixels(destination, QRect(0, height - top - rows, width, rows), out.constData());
+            break;
+        case TransformType::ROTATE_HALF:
+            for (int row = 0; row < rows; row++)
+                std::reverse_copy(in + row * width, in + (row + 1) * width, out.data() + (rows - 1 - row) * width);
+            writePixels(destination, QRect(0, height - top - rows, width, rows), out.constData());
+            break;
+        case TransformType::ROTATE_CLOCKWISE:
+            // The strip becomes a strip of tile columns on the right, its first row the last column
+            for (int row = 0; row < rows; row++) {
+                for (int x = 0; x < width; x++)
+                    out[x * rows + rows - 1 - row] = in[row * width + x];
+            }
+            writePixels(destination, QRect(height - top - rows, 0, rows, width), out.constData());
+            break;
+        case TransformType::ROTATE_COUNTERCLOCKWISE:
+            for (int row = 0; row < rows; row++) {
+                for (int x = 0; x < width; x++)
+                    out[(width - 1 - x) * rows + row] = in[row * width + x];
+            }
+            writePixels(destination, QRect(top, 0, rows, width), out.constData());
+            break;
+        case TransformType::SHIFT: {
+            const int shiftX = wrap(dx, width);
+            for (int row = 0; row < rows; row++)
+                std::rotate_copy(in + row * width, in + (row + 1) * width - shiftX, in + (row + 1) * width, out.data() + row * width);
+
+            // Rows pushed off the bottom wrap around to the top
+            const int first = wrap(top + dy, height);
+            const int beforeWrap = qMin(rows, height - first);
+            writePixels(destination, QRect(0, first, width, beforeWrap), out.constData());
+            if (beforeWrap < rows)
+                writePixels(destination, QRect(0, 0, width, rows - beforeWrap), out.constData() + beforeWrap * width);
+            break;
+        }
+        case TransformType::INVERT_COLORS:
+            for (int i = 0; i < rows * width; i++)
+                out[i] = T(invert(in[i]));
+            writePixels(destination, QRect(0, top, width, rows), out.constData());
+            break;
+        }
+    }
+}